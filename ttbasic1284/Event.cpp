@@ -7,6 +7,11 @@
 // 修正 2019/08/19 SLEEP機能の仕様変更(ウオッチドックタイマ利用)
 // 修正 2019/08/30 ON PIN.. の仕様変更、ピンモードの引数の追加
 // 修正 2019/08/31 MEGA2560でのSLEEP BOD部コンパイルエラー不具合対応
+// 修正 2026/10/19 SLEEP前に内部EEPROMへの保存完了を待つように修正
+// 修正 2026/10/19 SLEEP前にデータファイルの書込みバッファを書き込むように修正
+// 修正 2026/10/19 イベントの飛び先行の判定(ページ実行の行キャッシュ用)の追加
+// 修正 2026/10/19 イベント設定の保存・復元(SNAPSHOT、RESUME用)の追加
+// 修正 2026/10/19 イベントの飛び先が他のバンクの場合はSNAPSHOTをエラーとするように修正
 
 #include <avr/sleep.h> 
 #include "Arduino.h"
@@ -30,6 +35,8 @@ TEventInfo tevt;
 typedef struct _EEventInfo {
   uint32_t prevInterrupt;        // 直前の割り込み
   uint8_t  mode;                 // モード(4ビット)
+  uint8_t  pmode;                // ピンモード
+  uint8_t  flgActive;            // 外部割込み実行状態 (0:未実行、1:実行中)
   uint8_t  action;               // 0:未登録、 1:I_GOTO、2:I_GOSUB(2ビット)
   volatile uint8_t flgEvent;     // 発生フラグ（キュー）(1ビット)
   uint16_t param;                // 呼び出し行|ラベル位置
@@ -62,6 +69,21 @@ void handleExt1Event() {
   handleExt1EventSub(1);
 }
 
+// イベントの飛び先行の判定
+// (ページ実行の行キャッシュで、飛び先の行を追い出さないための判定)
+// 引数
+//  top,end : 判定範囲(top以上end未満)
+// 戻り値
+//  0:飛び先でない 1:飛び先
+uint8_t isEventLine(uint8_t* top, uint8_t* end) {
+  if (tevt.action && tevt.param >= (uint16_t)top && tevt.param < (uint16_t)end)
+    return 1;
+  for (uint8_t i = 0; i < 2; i++)
+    if (eevt[i].action && eevt[i].param >= (uint16_t)top && eevt[i].param < (uint16_t)end)
+      return 1;
+  return 0;
+}
+
 // タイマーイベント利用クリア
 void clerTimerEvent() {
   Timer1.stop();      // 初期は停止状態
@@ -75,9 +97,11 @@ void clerTimerEvent() {
 void clerExtEvent() {
   eevt[0].prevInterrupt = 0;    // 0:未登録、 1:I_GOTO、2:I_GOSUB
   eevt[0].action = 0;           // 0:未登録、 1:I_GOTO、2:I_GOSUB
+  eevt[0].flgActive = 0;        // 外部割込み実行状態 (0:未実行)
   eevt[0].flgEvent = 0;         // 発生フラグ（キュー） なし
   eevt[1].prevInterrupt = 0;    // 0:未登録、 1:I_GOTO、2:I_GOSUB
   eevt[1].action = 0;           // 0:未登録、 1:I_GOTO、2:I_GOSUB
+  eevt[1].flgActive = 0;        // 外部割込み実行状態 (0:未実行)
   eevt[1].flgEvent = 0;         // 発生フラグ（キュー） なし
 }
 
@@ -110,6 +134,7 @@ void iOnPinTimer() {
       if ( getParam(smode, 0,3, false) ) return;     // 検出モードの取得
       if (pmode != INPUT && pmode != INPUT_PULLUP) return;       
       eevt[pin-2].mode = smode;    // 検出モード
+      eevt[pin-2].pmode = pmode;   // ピンモード
       eevt[pin-2].flgEvent = 0;    // 発生フラグ（キュー） なし
       pinMode(pin, pmode);
   } else {
@@ -145,6 +170,29 @@ void iOnPinTimer() {
   }
 }
 
+// タイマー割込みの開始
+static void startTimer() {
+  tevt.flgActive = 1;
+  tevt.flgEvent = 0;
+  Timer1.initialize(((uint32_t)tevt.period)*1000L); 
+  Timer1.start();
+//  MsTimer2::set(tevt.period, handleTimerEvent); 
+//  MsTimer2::start();
+  delay(10);
+  tevt.flgEvent = 0 ;      // 割り込み発生リセット（初回クリア）
+}
+
+// 外部割込みの開始
+// 引数
+//  no : 0:ピン2 1:ピン3
+static void startExt(uint8_t no) {
+  eevt[no].flgActive = 1;
+  eevt[no].flgEvent = 0;
+  eevt[no].prevInterrupt =  millis();
+  if (no == 0)  { attachInterrupt(0, handleExt0Event, eevt[0].mode);  }
+  else          { attachInterrupt(1, handleExt1Event, eevt[1].mode); }
+}
+
 // TIMER ON|OFF
 void iTimer() {
   int16_t sw;
@@ -159,14 +207,7 @@ void iTimer() {
 
   // タイマー割込みの設定
   if (sw) {
-    tevt.flgActive = 1;
-    tevt.flgEvent = 0;
-    Timer1.initialize(((uint32_t)tevt.period)*1000L); 
-    Timer1.start();
-//    MsTimer2::set(tevt.period, handleTimerEvent); 
-//    MsTimer2::start();
-    delay(10);
-    tevt.flgEvent = 0 ;      // 割り込み発生リセット（初回クリア）
+    startTimer();
   } else {
     Timer1.stop();
 //    MsTimer2::stop();
@@ -188,17 +229,77 @@ void iPin() {
       err = ERR_NOEDEF; // タイマーイベント未設定
       return;      
     }
-    eevt[pin-2].flgEvent = 0;
     // 外部割込みの設定
-    eevt[pin-2].prevInterrupt =  millis();
-    if (pin == 2)  { attachInterrupt(0, handleExt0Event, eevt[0].mode);  }
-    else           { attachInterrupt(1, handleExt1Event, eevt[1].mode); }
+    startExt(pin-2);
   } else {
+    eevt[pin-2].flgActive = 0;
     eevt[pin-2].flgEvent = 0;
     detachInterrupt(pin-2);
   }
 }
 
+// イベントの飛び先のプログラム領域先頭からの位置への変換
+// 引数
+//  param : 飛び先
+//  pos   : 位置の格納先
+// 戻り値
+//  0:正常 1:プログラム領域外(他のバンク)
+static uint8_t evtPos(uint16_t param, uint16_t& pos) {
+  if (param < (uint16_t)listbuf || param >= (uint16_t)listbuf + SIZE_LIST)
+    return 1;
+  pos = param - (uint16_t)listbuf;
+  return 0;
+}
+
+// イベント設定の保存(SNAPSHOT)
+// (飛び先はプログラム領域先頭からの位置とする)
+// 引数
+//  e : 保存先
+// 戻り値
+//  0:正常 1:飛び先がプログラム領域外(他のバンク)
+uint8_t evtSave(evtsnap_t* e) {
+  e->period  = tevt.period;
+  e->tactive = tevt.flgActive;
+  e->taction = tevt.action;
+  e->tparam  = 0;
+  if (tevt.action && evtPos(tevt.param, e->tparam))
+    return 1;
+  for (uint8_t i = 0; i < 2; i++) {
+    e->emode[i]   = eevt[i].mode;
+    e->epmode[i]  = eevt[i].pmode;
+    e->eactive[i] = eevt[i].flgActive;
+    e->eaction[i] = eevt[i].action;
+    e->eparam[i]  = 0;
+    if (eevt[i].action && evtPos(eevt[i].param, e->eparam[i]))
+      return 1;
+  }
+  return 0;
+}
+
+// イベント設定の復元(RESUME)
+// (実行中だったタイマー・外部割込みは再開する)
+// 引数
+//  e : 保存データ
+void evtRestore(evtsnap_t* e) {
+  clerTimerEvent();
+  clerExtEvent();
+  tevt.period = e->period;
+  tevt.action = e->taction;
+  tevt.param  = (uint16_t)listbuf + e->tparam;
+  if (tevt.action && e->tactive)
+    startTimer();
+  for (uint8_t i = 0; i < 2; i++) {
+    eevt[i].mode   = e->emode[i];
+    eevt[i].pmode  = e->epmode[i];
+    eevt[i].action = e->eaction[i];
+    eevt[i].param  = (uint16_t)listbuf + e->eparam[i];
+    if (eevt[i].action && e->eactive[i]) {
+      pinMode(i+2, eevt[i].pmode);
+      startExt(i);
+    }
+  }
+}
+
 // タイマーイベントの実行
 void doTimerEvent() {
   if (tevt.flgActive && tevt.flgEvent) {
@@ -301,6 +402,9 @@ void isleep() {
     if (getParam(tm,0,8000,false)) return;  // 待ち時間
   }  
 
+  waitSave();  // 内部EEPROMへの保存中の場合は完了を待つ
+  iflush();    // データファイルの書込みバッファを書き込む
+  if (err) return;
   Serial.end();
   if (tm != 0) {
     // 無限待ちでない場合、ウオッチドックタイマの設定
@@ -54,6 +54,24 @@
 //  修正 2019/09/11 LOADでプログラム中で別プログラムをロード実行可能に修正
 //  修正 2019/10/08 NeoPixelのエラーメッセージの追加
 //  修正 2019/11/01 Else単独記述時、直前のIf判定結果で実行する機能の追加
+//  修正 2026/10/19 自動起動時の高速起動対応(起動時間をSYSINFOで表示)
+//  修正 2026/10/19 内部EEPROMの保存データ破損エラーの追加
+//  修正 2026/10/19 SAVE()関数の追加(内部EEPROMへの保存処理の残りバイト数)
+//  修正 2026/10/19 ERASEの消去オプション(WIPE)の追加
+//  修正 2026/10/19 COMPACTコマンドの追加(I2C EEPROMの詰め直し)
+//  修正 2026/10/19 I2C EEPROMのデータファイルコマンド(OPEN,WRITE#,READ#,FLUSH,CLOSE)、LOF()関数の追加
+//  修正 2026/10/19 配列・変数の保存・読込み(ASAVE,ALOAD)、変数を保持して実行(RUN VAR)の追加
+//  修正 2026/10/19 変数を保持したプログラムの連結実行(CHAIN)の追加
+//  修正 2026/10/19 I2C EEPROMのプログラムのページ実行(RUN "ファイル名")の追加(USE_PAGEDRUN)
+//  修正 2026/10/19 プログラム領域のバンク(BANK、CALL BANK)の追加(PRGBANKNUM)
+//  修正 2026/10/19 ROMプログラム(RUN ROM,LOAD ROM,SAVE ROM,FILES ROM)の追加(USE_ROMPRG)
+//  修正 2026/10/19 実行状態の保存・復元(SNAPSHOT、RESUME、RESUME())の追加(USE_SNAPSHOT)
+//  修正 2026/10/19 プログラムの不要部分の削除(PACK)の追加
+//  修正 2026/10/19 RENUMの対象範囲指定、行インデックスによる1回の走査での付け替えに変更
+//  修正 2026/10/19 DELETEの範囲削除を1回の移動で行うように変更
+//  修正 2026/10/19 プログラムの一括入力(UPLOAD)の追加(USE_UPLOAD)
+//  修正 2026/10/19 追加したキーワード、コマンドを機能の利用設定で有効化するように変更
+//  修正 2026/10/19 プログラムの形式チェック(checkList)の追加
 //
 
 #include <Arduino.h>
@@ -91,6 +109,8 @@
 #define CHAR_ESCAPE     0x1B 
 #define CHAR_DEL        0x02
 #define CHAR_CTRL_C     3
+#define CHAR_XON        0x11
+#define CHAR_XOFF       0x13
 
 //*** BASIC言語 キーワード定義 *********************
 // ※中間コードは basic.hに定義
@@ -190,6 +210,48 @@ KW(k169,"RGB");KW(k170,"NLine"); KW(k171,"NScroll"); KW(k173,"NPoint");
 #if USE_EVENT == 1 || USE_ALL_KEYWORD == 1
 KW(k175,"Timer"); KW(k176,"Pin"); KW(k181,"Sleep");
 #endif
+// EEPROMの保存管理
+#if USE_ERASEWIPE == 1 || USE_ALL_KEYWORD == 1
+KW(k182,"Wipe");
+#endif
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 || USE_ALL_KEYWORD == 1
+KW(k183,"Compact");
+#endif
+#if USE_DATAFILE == 1 || USE_ALL_KEYWORD == 1
+KW(k184,"Open");
+#endif
+#if USE_DATAFILE == 1 || USE_PAGEDRUN == 1 || USE_ALL_KEYWORD == 1
+KW(k185,"Append");
+#endif
+#if USE_DATAFILE == 1 || USE_ALL_KEYWORD == 1
+KW(k186,"Write#"); KW(k187,"Read#"); KW(k188,"Flush"); KW(k189,"Close"); KW(k190,"Lof");
+#endif
+#if USE_ADATA == 1 || USE_ALL_KEYWORD == 1
+KW(k191,"ASave"); KW(k192,"ALoad");
+#endif
+#if USE_CHAIN == 1 || USE_ALL_KEYWORD == 1
+KW(k193,"Chain");
+#endif
+// プログラムバンク
+#if PRGBANKNUM > 1 || USE_ALL_KEYWORD == 1
+KW(k194,"Bank"); KW(k195,"Call");
+#endif
+// ROMプログラム
+#if USE_ROMPRG == 1 || USE_ALL_KEYWORD == 1
+KW(k196,"Rom");
+#endif
+// 実行状態の保存・復元
+#if USE_SNAPSHOT != 0 || USE_ALL_KEYWORD == 1
+KW(k197,"Snapshot"); KW(k198,"Resume");
+#endif
+// プログラムの不要部分の削除
+#if USE_PACK == 1 || USE_ALL_KEYWORD == 1
+KW(k199,"Pack");
+#endif
+// プログラムの一括入力
+#if USE_UPLOAD == 1 || USE_ALL_KEYWORD == 1
+KW(k200,"Upload");
+#endif
 
 KW(k071,"OK");
 
@@ -269,6 +331,48 @@ const char*  const kwtbl[] PROGMEM = {
 #if USE_EVENT == 1 || USE_ALL_KEYWORD == 1
   k175,k176,k181,
   
+#endif
+// EEPROMの保存管理
+#if USE_ERASEWIPE == 1 || USE_ALL_KEYWORD == 1
+  k182,                                              // "WIPE"
+#endif
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 || USE_ALL_KEYWORD == 1
+  k183,                                              // "COMPACT"
+#endif
+#if USE_DATAFILE == 1 || USE_ALL_KEYWORD == 1
+  k184,                                              // "OPEN"
+#endif
+#if USE_DATAFILE == 1 || USE_PAGEDRUN == 1 || USE_ALL_KEYWORD == 1
+  k185,                                              // "APPEND"
+#endif
+#if USE_DATAFILE == 1 || USE_ALL_KEYWORD == 1
+  k186,k187,k188,k189,k190,                          // "WRITE#","READ#","FLUSH","CLOSE","LOF"
+#endif
+#if USE_ADATA == 1 || USE_ALL_KEYWORD == 1
+  k191,k192,                                         // "ASAVE","ALOAD"
+#endif
+#if USE_CHAIN == 1 || USE_ALL_KEYWORD == 1
+  k193,                                              // "CHAIN"
+#endif
+// プログラムバンク
+#if PRGBANKNUM > 1 || USE_ALL_KEYWORD == 1
+  k194,k195,                                         // "BANK","CALL"
+#endif
+// ROMプログラム
+#if USE_ROMPRG == 1 || USE_ALL_KEYWORD == 1
+  k196,                                              // "ROM"
+#endif
+// 実行状態の保存・復元
+#if USE_SNAPSHOT != 0 || USE_ALL_KEYWORD == 1
+  k197,k198,                                         // "SNAPSHOT","RESUME"
+#endif
+// プログラムの不要部分の削除
+#if USE_PACK == 1 || USE_ALL_KEYWORD == 1
+  k199,                                              // "PACK"
+#endif
+// プログラムの一括入力
+#if USE_UPLOAD == 1 || USE_ALL_KEYWORD == 1
+  k200,                                              // "UPLOAD"
 #endif
   k071,                                              // "OK"
 };
@@ -284,6 +388,9 @@ const PROGMEM unsigned char i_nsa[] = {
   I_LSHIFT, I_RSHIFT, I_OR, I_AND, I_NEQ, I_NEQ2, I_XOR,
   I_GTE, I_SHARP, I_GT, I_EQ, I_LTE, I_LT, I_LNOT, I_BITREV, I_DIVR,
   I_ARRAY, I_RND, I_ABS, I_SIZE,I_CLS, I_QUEST,
+#if USE_DATAFILE == 1 || USE_ALL_KEYWORD == 1
+  I_LOF,
+#endif
   I_CHR, I_HEX, I_BIN,I_STRREF,
 #if USE_RTC_DS3231 == 1 && USE_CMD_I2C == 1 || USE_ALL_KEYWORD == 1
   I_DATESTR,
@@ -344,6 +451,33 @@ const PROGMEM unsigned char i_sf[]  = {
   I_DATE, I_GETDATE, I_GETTIME, I_SETDATE,   // RTC関連コマンド(4)  
 #endif 
   I_FORMAT,I_DRIVE,
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 || USE_ALL_KEYWORD == 1
+  I_COMPACT,
+#endif
+#if USE_DATAFILE == 1 || USE_ALL_KEYWORD == 1
+  I_FOPEN,I_WRITE,I_READ,I_FLUSH,I_FCLOSE,
+#endif
+#if USE_ADATA == 1 || USE_ALL_KEYWORD == 1
+  I_ASAVE,I_ALOAD,
+#endif
+#if USE_CHAIN == 1 || USE_ALL_KEYWORD == 1
+  I_CHAIN,
+#endif
+#if PRGBANKNUM > 1 || USE_ALL_KEYWORD == 1
+  I_BANK,I_CALL,
+#endif
+#if USE_ROMPRG == 1 || USE_ALL_KEYWORD == 1
+  I_ROM,
+#endif
+#if USE_SNAPSHOT != 0 || USE_ALL_KEYWORD == 1
+  I_SNAPSHOT,
+#endif
+#if USE_PACK == 1 || USE_ALL_KEYWORD == 1
+  I_PACK,
+#endif
+#if USE_UPLOAD == 1 || USE_ALL_KEYWORD == 1
+  I_UPLOAD,
+#endif
 #if USE_SO1602AWWB == 1 && USE_CMD_I2C == 1 || USE_ALL_KEYWORD == 1
   I_CPRINT, I_CCLS, I_CCURS, I_CLOCATE, I_CCONS, I_CDISP,  
 #endif
@@ -440,6 +574,8 @@ KW(e29,"No event");
 #if USE_NEOPIXEL == 1 || USE_ALL_KEYWORD == 1
 KW(e30,"Need NInit");
 #endif
+KW(e31,"Checksum error");
+KW(e32,"File not open");
 
 
 // エラーメッセージテーブル
@@ -457,6 +593,7 @@ const char*  const errmsg[] PROGMEM = {
 #if USE_NEOPIXEL == 1 || USE_ALL_KEYWORD == 1
   e30,
 #endif
+  e31,e32,
 };
 
 //*** エラー発生情報保持変数 ************************
@@ -469,7 +606,13 @@ int16_t lbuf_pos = 0;        // コマンドライン内参照位置
 uint8_t ibuf[SIZE_IBUF];     // 中間コード変換バッファ
 int16_t var[26];             // 変数領域（A-Z×2バイト)
 int16_t arr[SIZE_ARRY];      // 配列変数領域
+#if PRGBANKNUM > 1
+uint8_t prgbank[PRGBANKNUM][SIZE_LIST]; // プログラム領域(バンク)
+uint8_t* listbuf = prgbank[0]; // プログラム領域(選択中のバンク)
+uint8_t curbank = 0;         // 編集・実行対象のバンク
+#else
 uint8_t listbuf[SIZE_LIST];  // プログラム領域
+#endif
 uint8_t* clp;                // カレント行先頭ポインタ
 uint8_t* cip;                // インタプリタ中間コード参照位置
 uint8_t* gstk[SIZE_GSTK];    // GOSUB スタック
@@ -478,6 +621,9 @@ uint8_t* lstk[SIZE_LSTK];    // FOR スタック
 uint8_t lstki;               // FOR 市タック インデックスtoktoi()
 uint8_t val_if = 1;          // if文判定結果
 uint8_t prevPressKey = 0;    // 直前入力キーの値(INKEY()、[ESC]中断キー競合防止用)
+#if USE_FASTBOOT == 1 && USE_SYSINFO == 1
+uint32_t bootTime = 0;       // 起動から最初の文の実行までの時間(usec、自動起動時のみ)
+#endif
 
 
 //*** 関数の定義 ***********************************
@@ -856,7 +1002,7 @@ void error(uint8_t flgCmd = false) {
   
     // もしプログラムの実行中のエラーなら発生行の内容を付加して出力する
     //（cip がプログラム領域の中にあり、clpが末尾ではない場合）
-    if (cip >= listbuf && cip < listbuf + SIZE_LIST && *clp && !flgCmd) {
+    if (isPrgArea(cip) && *clp && !flgCmd) {
     
       // エラーメッセージを表示      
       c_puts_P((const char*)pgm_read_word(&errmsg[err]));
@@ -864,6 +1010,10 @@ void error(uint8_t flgCmd = false) {
       errorLine = getlineno(clp);
       putnum(errorLine, 0); // 行番号を調べて表示
       newline();
+#if PRGBANKNUM > 1
+      if (!(clp >= listbuf && clp < listbuf + SIZE_LIST))
+        errorLine = -1;     // 編集対象以外のバンクの行
+#endif
 
       // リストの該当行を表示
       putnum(getlineno(clp), 0);
@@ -1225,6 +1375,24 @@ int16_t getsize() {
   return listbuf + SIZE_LIST - lp - 1; //残りを計算して持ち帰る
 }
 
+// プログラムの形式チェック
+// (行長、行番号の順序、行末の中間コードを確認する)
+// 引数
+//  lp   : プログラムの先頭
+//  size : 領域の大きさ
+// 戻り値
+//  0:正常 1:異常(データ破損、中間コードの構成が異なる版で保存したプログラム)
+uint8_t checkList(uint8_t* lp, uint16_t size) {
+  uint8_t* end = lp + size;
+  int16_t  prev = 0;
+  for (; lp < end && *lp; lp += *lp) {
+    if (*lp < 4 || lp + *lp >= end || getlineno(lp) <= prev || lp[*lp - 1] != I_EOL)
+      return 1;
+    prev = getlineno(lp);
+  }
+  return lp < end ? 0 : 1;
+}
+
 // 中間コード格納行の行番号取得(1行分リスト内行番号取得)
 int16_t getlineno(uint8_t *lp) {
   return  (*lp == 0) ? -1: *(lp + 1) | *(lp + 2) << 8; //行番号を持ち帰る
@@ -1233,6 +1401,10 @@ int16_t getlineno(uint8_t *lp) {
 // 指定行番号のリストポインタを取得
 uint8_t* getlp(short lineno) {
   uint8_t *lp; // ポインタ
+#if USE_PAGEDRUN == 1
+  if (isPaged())
+    return pgGetlp(lineno);  // ページ実行中は行キャッシュから取得
+#endif
   for (lp = listbuf; *lp && getlineno(lp) < lineno; lp += *lp); // 先頭から末尾まで繰り返す
   return lp; // ポインタを持ち帰る
 }
@@ -1263,21 +1435,6 @@ int16_t getNextLineNo(int16_t lineno) {
   return rc;
 }
 
-// 行番号から行インデックスを取得する
-uint16_t getlineIndex(uint16_t lineno) {
-  uint8_t *lp; // ポインタ
-  uint16_t index = 0;  
-  uint16_t rc = 32767;
-  for (lp = listbuf; *lp; lp += *lp) {           // 先頭から末尾まで繰り返す
-    if ((uint16_t)getlineno(lp) >= lineno) {     // もし指定の行番号以上なら
-      rc = index;
-      break;                                     // 繰り返しを打ち切る
-    }
-    index++;
-  }
-  return rc; 
-}
-
 // プログラム行数を取得する
 uint16_t countLines(int16_t st=0, int16_t ed=32767) {
   uint8_t *lp; //ポインタ
@@ -1298,6 +1455,10 @@ uint16_t countLines(int16_t st=0, int16_t ed=32767) {
 uint8_t* getlpByLabel(uint8_t* pLabel) {
   uint8_t *lp; //ポインタ
   uint8_t len;
+#if USE_PAGEDRUN == 1
+  if (isPaged())
+    return pgGetlpByLabel(pLabel);  // ページ実行中は行キャッシュから取得
+#endif
   pLabel++;
   len = *pLabel; // 長さ取得
   pLabel++;      // ラベル格納位置
@@ -1345,6 +1506,8 @@ void inslist() {
   uint8_t *p1, *p2; // 移動先と移動元
   uint16_t len;     // 移動の長さ
 
+  waitSave();       // プログラム保存中の場合は完了を待つ
+
   // 領域容量チャック
   if (getsize() < *ibuf) {
     err = ERR_LBUFOF;   // エラー番号をセット
@@ -1688,9 +1851,12 @@ uint8_t* getJumplp() {
 void iGotoGosub(uint8_t mode, uint16_t evtlp) {
   uint8_t* lp;
 
-  if (mode == MODE_ONGOTO || mode == MODE_ONGOSUB)
+  if (mode == MODE_ONGOTO || mode == MODE_ONGOSUB) {
     lp = (uint8_t *)evtlp;
-  else 
+#if PRGBANKNUM > 1
+    setBank(lp);          // イベント登録時のバンクに切替え
+#endif
+  } else 
     lp = getJumplp();     // 飛び先行ポインタ
 
   if (err)
@@ -1717,9 +1883,62 @@ void ireturn() {
   }
   cip = gstk[--gstki]; // 行ポインタを復帰
   clp = gstk[--gstki]; // 中間コードポインタを復帰
+#if PRGBANKNUM > 1
+  setBank(clp);        // CALL BANKからの復帰では呼出し元のバンクに戻す
+#endif
   return;  
 }
 
+#if PRGBANKNUM > 1
+// 指定行を含むバンクへの切替え
+// (CALL BANKからの復帰、他のバンクのFOR、イベント処理への分岐で利用)
+void setBank(uint8_t* lp) {
+  if (lp >= prgbank[0] && lp < prgbank[0] + sizeof(prgbank))
+    listbuf = prgbank[(lp - prgbank[0]) / SIZE_LIST];
+}
+
+// BANK バンク番号
+//  ※編集・実行対象のプログラム領域(バンク)を選択する(コマンドラインでのみ利用可能)
+void ibank() {
+  int16_t bank;
+  if (isPrgArea(cip)) {
+    err = ERR_COM;
+    return;
+  }
+  if ( getParam(bank, 0, PRGBANKNUM-1, false) )
+    return;
+  curbank = bank;
+  listbuf = prgbank[bank];
+}
+
+// CALL BANK バンク番号,行番号|ラベル
+//  ※指定バンクのプログラムをサブルーチンとして呼び出す(RETURNで呼出し元に戻る)
+void icallbank() {
+  int16_t  bank;
+  uint8_t* bak = listbuf;
+  if (*cip != I_BANK) {
+    err = ERR_SYNTAX;
+    return;
+  }
+  cip++;
+  if ( getParam(bank, 0, PRGBANKNUM-1, true) )
+    return;
+  listbuf = prgbank[bank];  // 飛び先は呼出し先のバンクで検索する
+  iGotoGosub(MODE_GOSUB);
+  if (err)
+    listbuf = bak;
+}
+#endif
+
+// プログラム領域(全バンク)内の判定
+uint8_t isPrgArea(uint8_t* p) {
+#if PRGBANKNUM > 1
+  return p >= prgbank[0] && p < prgbank[0] + sizeof(prgbank);
+#else
+  return p >= listbuf && p < listbuf + SIZE_LIST;
+#endif
+}
+
 // FOR
 void ifor() {
   int16_t index, vto, vstep; // FOR文の変数番号、終了値、増分
@@ -1805,6 +2024,9 @@ void inext() {
   // 開始値が終了値を超えていなかった場合
   cip = lstk[lstki - 4]; //行ポインタを復帰
   clp = lstk[lstki - 5]; //中間コードポインタを復帰
+#if PRGBANKNUM > 1
+  setBank(clp);          // 他のバンクのFORに戻る場合はバンクを切替える
+#endif
 }
 
 // スキップ
@@ -1853,97 +2075,366 @@ void ilist(uint8_t devno=0) {
   clp = bak_clp;
 }
 
-// RENUME [開始番号[,増分]]
+// 中間コード1個のサイズ(付随するデータを含む)
+// 引数
+//  p : 中間コードのアドレス
+// 戻り値
+//  サイズ(バイト数)
+static uint8_t tokSize(uint8_t* p) {
+  switch (*p) {
+  case I_STR:                       // 中間コード+文字数+文字列
+  case I_REM:
+  case I_SQUOT:   return p[1] + 2;  // 中間コード+文字数+コメント
+  case I_NUM:
+  case I_HEXNUM:
+  case I_BINNUM:  return 3;         // 中間コード+整数2バイト
+  case I_VAR:     return 2;         // 中間コード+変数番号
+  default:        return 1;
+  }
+}
+
+// RENUMの行インデックス
+// (対象範囲の行の一定行数間隔の行番号と行ポインタ、プログラム領域の空き部分に作成する)
+typedef struct {
+  int16_t  no;   // 行番号
+  uint8_t* lp;   // 行ポインタ
+} renidx_t;
+
+// RENUMの対象範囲内の行の位置(先頭行からの行数)の取得
+// 行インデックスを二分探索し、登録間隔内の行は順に辿る
+// 引数
+//  idx    : 行インデックス
+//  n      : 行インデックス登録数
+//  step   : 登録間隔(行数)
+//  cnt    : 対象範囲の行数
+//  lineno : 行番号
+// 戻り値
+//  対象範囲内の行の位置(該当する行がない場合は-1)
+static int16_t renumIndex(renidx_t* idx, uint16_t n, uint16_t step, uint16_t cnt, int16_t lineno) {
+  int16_t  lo = 0, hi = n - 1, mid;
+  uint8_t* lp;
+
+  if (!n || lineno < idx[0].no)
+    return -1;
+  while (lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    if (idx[mid].no <= lineno)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  lp = idx[lo].lp;
+  for (uint16_t i = lo * step; i < cnt && i < (lo + 1) * step; i++, lp += *lp) {
+    if (getlineno(lp) == lineno)
+      return i;
+    if (getlineno(lp) > lineno)
+      break;
+  }
+  return -1;
+}
+
+// RENUM [開始番号[,増分[,対象開始行番号[,対象終了行番号]]]]
 // ※引数には、符号無し10進数定数のみ指定可能
+//   対象範囲指定時は、範囲内の行のみ付け直す(範囲外の行と行番号の順序が入れ替わる、
+//   重なる場合はエラー)
+//   GOTO、GOSUB(ON TIMER、ON PINを含む)の行番号は、対象範囲の行の行インデックスを1回作成し、
+//   二分探索で新しい行番号に付け替える(該当する行がない場合は変更しない)
+//   CHAIN、CALL BANKの行番号は他のプログラムの行のため変更しない
 void irenum() {
-  int16_t startLineNo = 10;   // 開始行番号
-  int16_t increase = 10;      // 増分
-  uint8_t* ptr;               // プログラム領域参照ポインタ
-  uint8_t  len;               // 行長さ
-  uint8_t  i;                 // 中間コード参照位置
-  uint16_t newnum;            // 新しい行番号
-  uint16_t num;               // 現在の行番号
-  uint16_t index;             // 行インデックス
-  uint16_t cnt;               // プログラム行数
-  uint8_t *bak_clp;           // バックアップ
+  int16_t  startLineNo = 10;  // 開始行番号
+  int16_t  increase = 10;     // 増分
+  int16_t  st = 0;            // 対象開始行番号
+  int16_t  ed = 32767;        // 対象終了行番号
+  int16_t  prev = -1;         // 対象範囲の直前の行番号
+  int16_t  next = -1;         // 対象範囲の直後の行番号
+  int16_t  no, k;
+  uint16_t cnt = 0;           // 対象範囲の行数
+  uint16_t n = 0;             // 行インデックス登録数
+  uint16_t step = 1;          // 行インデックス登録間隔
+  uint16_t max;               // 行インデックス最大登録数
+  renidx_t* idx;              // 行インデックス
+  uint8_t* lp;
+  uint8_t* p;
   
-  // 開始行番号、増分引数チェック
+  // 開始行番号、増分、対象範囲引数チェック
   if (*cip != I_EOL && *cip != I_COLON) {
     // 引数あり
     if (getParam(startLineNo,1,32767,false)) return;     // 開始行番号
     if (*cip == I_COMMA) {
       cip++;                                             // カンマをスキップ
       if (getParam(increase,1,32767,false)) return;      // 増分
-     }
+      if (*cip == I_COMMA) {
+        cip++;
+        if (getParam(st,0,32767,false)) return;          // 対象開始行番号
+        if (*cip == I_COMMA) {
+          cip++;
+          if (getParam(ed,st,32767,false)) return;       // 対象終了行番号
+        }
+      }
+    }
   }
 
-  // 引数の有効性チェック
-  cnt = countLines()-1;
-  if ( (startLineNo <= 0 || increase <= 0) ||
-       (startLineNo + increase * cnt > 32767) ) {
+  waitSave();  // プログラム保存中の場合は完了を待つ
+
+  // 対象範囲の行の行インデックスの作成
+  // (登録数が一杯になったら1つおきに間引き、登録間隔を2倍にする)
+  idx = (renidx_t*)(listbuf + SIZE_LIST - getsize());
+  max = getsize() / sizeof(renidx_t);
+  if (max < 2) {
+    err = ERR_LBUFOF;  // 行インデックスの作成領域なし
+    return;
+  }
+  for (lp = listbuf; *lp; lp += *lp) {
+    no = getlineno(lp);
+    if (no < st) {
+      prev = no;
+      continue;
+    }
+    if (no > ed) {
+      next = no;
+      break;
+    }
+    if (!(cnt % step)) {
+      if (n == max) {
+        n = (max + 1) / 2;
+        for (uint16_t i = 0; i < n; i++)
+          idx[i] = idx[i*2];
+        step *= 2;
+      }
+      if (!(cnt % step)) {
+        idx[n].no = no;
+        idx[n].lp = lp;
+        n++;
+      }
+    }
+    cnt++;
+  }
+  if (!cnt)
+    return;
+
+  // 引数の有効性チェック(新しい行番号が範囲外の行を超えないこと)
+  if ( startLineNo <= prev ||
+       (int32_t)startLineNo + (int32_t)increase * (cnt-1) > (next < 0 ? 32767 : next - 1) ) {
     err = ERR_VALUE;
     return;   
   }
 
-  bak_clp = clp;
-  // ブログラム中のGOTOの飛び先行番号を付け直す
-  for (clp = listbuf; *clp ; clp += *clp) {
-     ptr = clp;
-     len = *ptr;
-     ptr++;
-     i=0;
-     // 行内検索
-     while( i < len-1 ) {
-        switch(ptr[i]) {
-        case I_GOTO:  // GOTO命令
-        case I_GOSUB: // GOSUB命令
-          i++;
-          if (ptr[i] == I_NUM) {
-            num = getlineno(&ptr[i]);    // 現在の行番号を取得する
-            index = getlineIndex(num);   // 行番号の行インデックスを取得する
-            if (index == 32767) {
-               // 該当する行が見つからないため、変更は行わない
-               i+=3;
-               continue;
-            } else {
-               // とび先行番号を付け替える
-               newnum = startLineNo + increase*index;
-               ptr[i+2] = newnum>>8;
-               ptr[i+1] = newnum&0xff;
-               i+=3;
-               continue;
-            }
-          } 
-          break;
-      case I_STR:  // 文字列
-        i++;
-        i+=ptr[i]; // 文字列長分移動
-        break;
-      case I_NUM:  // 定数
-      case I_HEXNUM:
-      case I_BINNUM: 
-        i+=3;      // 整数2バイト+中間コード1バイト分移動
+  // ブログラム中のGOTO、GOSUBの飛び先行番号を付け直す
+  for (lp = listbuf; *lp; lp += *lp) {
+    for (p = lp + 3; *p != I_EOL; p += tokSize(p)) {
+      if ((*p == I_GOTO || *p == I_GOSUB) && p[1] == I_NUM) {
+        p++;
+        if ( (k = renumIndex(idx, n, step, cnt, getlineno(p))) >= 0 ) {
+          no = startLineNo + increase * k;
+          p[1] = no & 0xff;
+          p[2] = no >> 8;
+        }
+      }
+    }
+  }
+
+  // 対象範囲の各行の行番号の付け替え
+  lp = idx[0].lp;
+  for (k = 0; k < (int16_t)cnt; k++, lp += *lp) {
+    no = startLineNo + increase * k;
+    lp[1] = no & 0xff;
+    lp[2] = no >> 8;
+  }
+}
+#if USE_PACK == 1
+#define LINE_MARK  0x80  // 飛び先の行の印(行番号の上位バイトの最上位ビット)
+
+// 飛び先の行への印付け(PACK用)
+// 引数
+//  p : 飛び先の指定(行番号またはラベルの中間コード)
+// 戻り値
+//  0:正常 1:飛び先を特定できない(計算式による行番号の指定)
+static uint8_t markTarget(uint8_t* p) {
+  uint8_t* tp;
+
+  if (*p == I_NUM && (p[3] == I_EOL || p[3] == I_COLON || p[3] == I_ELSE)) {
+    // 行番号の飛び先
+    for (tp = listbuf; *tp; tp += *tp) {
+      if ( (getlineno(tp) & 0x7FFF) == getlineno(p) ) {
+        tp[2] |= LINE_MARK;
         break;
-      case I_VAR:  // 変数
-        i+=2;      // 変数名
+      }
+    }
+  } else if (*p == I_STR) {
+    // ラベルの飛び先
+    for (tp = listbuf; *tp; tp += *tp) {
+      if (tp[3] == I_STR && tp[4] == p[1] && !strncmp((char*)tp+5, (char*)p+2, p[1])) {
+        tp[2] |= LINE_MARK;
         break;
-      default:     // その他
-        i++;
+      }
+    }
+  } else {
+    return 1;   // 計算式による行番号
+  }
+  return 0;
+}
+
+// 飛び先の行への印付け(PACK用)
+// GOTO、GOSUB(ON TIMER、ON PINを含む)の行番号、ラベルの飛び先の行番号の最上位ビットを立てる
+// 他のバンクのCALL BANKによる、このバンクの飛び先にも印を付ける
+// 戻り値
+//  0:正常 1:行の構成を変更できない(計算式による飛び先の指定、CHAIN、CALL BANKの利用あり)
+static uint8_t markTargets() {
+  uint8_t* lp;
+  uint8_t* p;
+  uint8_t  rc = 0;
+
+  for (lp = listbuf; *lp; lp += *lp) {
+    for (p = lp + 3; *p != I_EOL; p += tokSize(p)) {
+#if USE_CHAIN == 1 || USE_ALL_KEYWORD == 1
+      if (*p == I_CHAIN) {
+        rc = 1;   // 他のプログラムと連携するプログラム(行番号、ラベルで呼び出される)
+        continue;
+      }
+#endif
+#if PRGBANKNUM > 1 || USE_ALL_KEYWORD == 1
+      if (*p == I_CALL) {
+        rc = 1;
+        continue;
+      }
+#endif
+      if (*p != I_GOTO && *p != I_GOSUB)
+        continue;
+      p++;
+      rc |= markTarget(p);
+      if (*p == I_EOL)
         break;
+    }
+  }
+
+#if PRGBANKNUM > 1
+  // 他のバンクからのCALL BANK バンク番号,行番号|ラベル
+  for (uint8_t bank = 0; bank < PRGBANKNUM; bank++) {
+    if (prgbank[bank] == listbuf)
+      continue;
+    for (lp = prgbank[bank]; *lp; lp += *lp) {
+      for (p = lp + 3; *p != I_EOL; p += tokSize(p)) {
+        if (*p != I_CALL || p[1] != I_BANK)
+          continue;
+        p += 2;
+        if (*p != I_NUM || p[3] != I_COMMA) {
+          rc = 1;   // 計算式によるバンク番号
+        } else if (getlineno(p) == curbank) {
+          rc |= markTarget(p + 4);
+        }
+        if (*p == I_EOL)
+          break;
       }
     }
   }
-  
-  // 各行の行番号の付け替え
-  index = 0;
-  for ( clp = listbuf; *clp ; clp += *clp ) {
-     newnum = startLineNo + increase * index;
-     *(clp+1)  = newnum&0xff;
-     *(clp+2)  = newnum>>8;
-     index++;
+#endif
+  return rc;
+}
+
+// 実行イメージの作成(PACK用)
+// プログラムの不要部分を削除し、実行結果が同じプログラムを作成する
+// ・REM、'のコメントを削除する(コメントのみの行は削除する)
+// ・代入文のLETを削除する
+// ・飛び先でない行は、直前の行に:で連結する
+//   (直前の行にIF、ELSE、END、GOTO、RETURNがある場合、連結後の行長がSIZE_IBUFを超える場合は
+//    連結しない ※ENDは行の残りの文を実行するため、連結すると実行されなかった文が実行される)
+// ・飛び先でない行の先頭のラベルを削除する
+//  ※計算式による飛び先の指定、CHAIN、CALL BANKの利用がある場合は、行の連結、ラベルの削除は行わない
+//    他のバンクのCALL BANKの飛び先は保持する
+//    CHAINで他のファイルから呼び出されるだけのプログラムは、呼出し元の飛び先を考慮しない
+//    1行ずつlbufに変換してから書き込むため、作成先がプログラム領域の先頭でもよい
+// 引数
+//  dst   : 作成先(listbufの場合はプログラム領域上で変換する)
+//  limit : 作成先のサイズ
+// 戻り値
+//  作成したイメージの長さ(終端を含む、作成先に収まらない場合は0、errにERR_LBUFOFを設定)
+uint16_t packList(uint8_t* dst, uint16_t limit) {
+  uint8_t* rp;            // 読込み位置
+  uint8_t* next;          // 次の行の読込み位置(書込みで行長が上書きされるため事前に求める)
+  uint8_t* wp = dst;      // 書込み位置
+  uint8_t* top = NULL;    // 作成中の行の先頭
+  uint8_t* p;
+  uint8_t  flgFixed;      // 行の連結、ラベルの削除不可
+  uint8_t  flgJoin = 0;   // 作成中の行への連結可能フラグ
+  uint8_t  flgCond;       // IF、ELSE、END、GOTO、RETURNあり(次の行を連結しない)
+  uint8_t  mark, len, sz;
+  uint8_t  no[2];         // 行番号
+
+  flgFixed = markTargets();
+  for (rp = listbuf; *rp; rp = next) {
+    next  = rp + *rp;
+    mark  = rp[2] & LINE_MARK;
+    no[0] = rp[1];
+    no[1] = rp[2] & ~LINE_MARK;
+    p = rp + 3;
+    if (*p == I_STR && !mark && !flgFixed)
+      p += tokSize(p);    // 参照されないラベル
+
+    // 行の中間コードをlbufに変換する
+    len = 0;
+    flgCond = 0;
+    while (*p != I_EOL && *p != I_REM && *p != I_SQUOT) {
+      if (*p == I_COLON && (!len || lbuf[len-1] == I_COLON)) {
+        p++;              // 先頭、連続する:
+        continue;
+      }
+      if (*p == I_LET && (p[1] == I_VAR || p[1] == I_ARRAY)) {
+        p++;              // 代入文のLET
+        continue;
+      }
+      if (*p == I_IF || *p == I_ELSE || *p == I_END || *p == I_GOTO || *p == I_RETURN)
+        flgCond = 1;
+      sz = tokSize(p);
+      memcpy(lbuf+len, p, sz);
+      len += sz;
+      p += sz;
+    }
+    while (len && lbuf[len-1] == I_COLON)
+      len--;              // 末尾の:
+    if (!len && !mark)
+      continue;           // 文のない行は削除する
+
+    // 作成中の行への連結、または新しい行の作成
+    if (top && flgJoin && len && !mark && !flgFixed && wp - top + len + 2 <= SIZE_IBUF) {
+      if (wp + len + 2 > dst + limit)
+        goto OVER;
+      *wp++ = I_COLON;
+    } else {
+      if (top) {
+        *wp++ = I_EOL;
+        *top = wp - top;
+      }
+      if (wp + len + 5 > dst + limit)
+        goto OVER;
+      top = wp;
+      *wp++ = 0;
+      *wp++ = no[0];
+      *wp++ = no[1];
+      flgJoin = 1;
+    }
+    memcpy(wp, lbuf, len);
+    wp += len;
+    if (flgCond)
+      flgJoin = 0;        // 以降は条件付きで実行される文、実行されない文のため、次の行を連結しない
   }
-  clp = bak_clp;
+  if (top) {
+    *wp++ = I_EOL;
+    *top = wp - top;
+  }
+  *wp++ = 0;
+  if (dst != listbuf) {
+    for (p = listbuf; *p; p += *p)
+      p[2] &= ~LINE_MARK; // 印を消す
+  }
+  return wp - dst;
+
+OVER:
+  for (p = listbuf; *p; p += *p)
+    p[2] &= ~LINE_MARK;
+  err = ERR_LBUFOF;
+  return 0;
 }
+#endif
 
 // 指定行の削除
 // DELETE 行番号
@@ -1951,28 +2442,31 @@ void irenum() {
 void idelete() {
   int16_t sNo;       // 開始行番号
   int16_t eNo;       // 終了行番号
-  uint8_t *lp;       // 削除位置ポインタ
-  int16_t n;         // 削除対象行
+  uint8_t *sp;       // 削除範囲の先頭行ポインタ
+  uint8_t *ep;       // 削除範囲の次の行ポインタ
+  uint8_t *lp;       // プログラム末尾ポインタ
 
   if ( getParam(sNo, false) ) return;
+  waitSave();        // プログラム保存中の場合は完了を待つ
   if (*cip == I_COMMA) {
      cip++;
      if ( getParam(eNo, sNo,32767,false) ) return;  
   } else {
      eNo = sNo;
   }
-  // 行ポインタを表示開始行番号へ進める
-  lp = getlp(sNo);
-  for (;;) {
-     n = getlineno(lp);
-     if (n < 0 || n > eNo)
-        break;
-     dellist(n);
+  // 削除範囲の先頭行と次の行を求め、以降の行を1回で前へ詰める
+  sp = getlp(sNo);
+  for (ep = sp; *ep && getlineno(ep) <= eNo; ep += *ep);
+  if (ep != sp) {
+    for (lp = ep; *lp; lp += *lp);  // lpをリストの末尾へ移動
+    memmove(sp, ep, lp - ep + 1);   // 末尾の0を含めて移動
   }
 }
 
 //NEW command handler
 void inew(void) {
+  waitSave();    // プログラム保存中の場合は完了を待つ
+
   // 変数と配列の初期化
   memset(var,0,26);
   memset(arr,0,SIZE_ARRY);
@@ -2031,6 +2525,20 @@ char top = 't';
   // コマンドエントリー数
   c_puts_P((const char*)F("\nCommand table:"));
   putnum((int16_t)(I_EOL+1),0);
+
+#if USE_FASTBOOT == 1
+  // 起動時間(自動起動時の最初の文実行までの時間 0.1ms単位)
+  if (bootTime) {
+    uint16_t t = bootTime/100 > 32767 ? 32767 : bootTime/100;
+    c_puts_P((const char*)F("\nBoot time:"));
+    putnum(t/10,0); c_putch('.'); putnum(t%10,0);
+    c_puts_P((const char*)F("ms"));
+  }
+#endif
+#if USE_PAGEDRUN == 1
+  // ページ実行の行キャッシュの統計情報
+  pgInfo();
+#endif
 /*
   // タイマーイベント
   putnum((int16_t)(te_period),0);
@@ -2239,6 +2747,14 @@ int16_t ivalue() {
     value = getsize();        // プログラム保存領域の空きを取得
     break;
 
+  case I_SAVE:    value = isavestat(); break; // 関数SAVE() 保存処理の残りバイト数
+#if USE_SNAPSHOT != 0
+  case I_RESUME:  value = iresumestat(); break; // 関数RESUME() RESUMEによる再開の判定
+#endif
+#if USE_DATAFILE == 1
+  case I_LOF:     value = ilof();     break; // 関数LOF() データファイルのファイル長
+#endif
+
   case I_INKEY:   value = iinkey();   break; // 関数INKEY    
   case I_BYTE:    value = iwlen();    break; // 関数BYTE(文字列)   
   case I_LEN:     value = iwlen(1);   break; // 関数LEN(文字列)
@@ -2455,18 +2971,50 @@ uint8_t* iexe() {
 #endif
 #endif
     case I_SYSINFO:   iinfo();          break;  // SYSINFO     
-    case I_RENUM: irenum();             break;  // RENUMの場合
-    case I_DELETE:idelete();            break;  // DELETE
+    // ページ実行中はプログラム領域、実行中のファイルを変更するコマンドは利用不可
+    case I_RENUM: if (!checkPaged()) irenum();             break;  // RENUMの場合
+    case I_DELETE:if (!checkPaged()) idelete();            break;  // DELETE
 
-    case I_NEW:   inew();               break;  // NEW  
-    case I_LIST:  ilist();              break;  // LIST
-    case I_LOAD:  iLoadSave(MODE_LOAD); break;  // LOAD
-    case I_SAVE:  iLoadSave(MODE_SAVE); break;  // SAVE
+    case I_NEW:   if (!checkPaged()) inew();               break;  // NEW  
+    case I_LIST:  if (!checkPaged()) ilist();              break;  // LIST
+    case I_LOAD:  if (!checkPaged()) iLoadSave(MODE_LOAD); break;  // LOAD
+    case I_SAVE:  if (!checkPaged()) iLoadSave(MODE_SAVE); break;  // SAVE
 
-    case I_ERASE: ierase();   break;  // ERASE
+    case I_ERASE: if (!checkPaged()) ierase();   break;  // ERASE
     case I_FILES: ifiles();   break;  // FILES
-    case I_FORMAT:iformat();  break;  // FORMAT
-    case I_DRIVE: idrive();   break;  // DRIVE
+    case I_FORMAT:if (!checkPaged()) iformat();  break;  // FORMAT
+    case I_DRIVE: if (!checkPaged()) idrive();   break;  // DRIVE
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+    case I_COMPACT:if (!checkPaged()) icompact();break;  // COMPACT
+#endif
+#if USE_DATAFILE == 1
+    case I_FOPEN: iopen();    break;  // OPEN
+    case I_WRITE: iwrite();   break;  // WRITE#
+    case I_READ:  iread();    break;  // READ#
+    case I_FLUSH: iflush();   break;  // FLUSH
+    case I_FCLOSE:iclose();   break;  // CLOSE
+#endif
+#if USE_ADATA == 1
+    case I_ASAVE: iAData(MODE_SAVE); break;  // ASAVE
+    case I_ALOAD: iAData(MODE_LOAD); break;  // ALOAD
+#endif
+#if USE_CHAIN == 1
+    case I_CHAIN: if (!checkPaged()) ichain();   break;  // CHAIN
+#endif
+#if USE_PACK == 1
+    case I_PACK:  if (!checkPaged()) ipack();    break;  // PACK
+#endif
+#if USE_UPLOAD == 1
+    case I_UPLOAD:err = ERR_COM; break;  // UPLOAD(コマンドラインのみ)
+#endif
+#if USE_SNAPSHOT != 0
+    case I_SNAPSHOT: if (!checkPaged()) isnapshot(); break;  // SNAPSHOT
+    case I_RESUME:   if (!checkPaged()) iresume();   break;  // RESUME
+#endif
+#if PRGBANKNUM > 1
+    case I_BANK:  ibank();    break;  // BANK
+    case I_CALL:  if (!checkPaged()) icallbank(); break;  // CALL BANK
+#endif
 
     case I_COLON:     break; // 中間コードが「:」の場合   
       
@@ -2495,30 +3043,50 @@ uint8_t* iexe() {
 }
 
 // プログラム初期化
-void initProgram() {
+// 引数
+//  flgKeep  0以外:変数と配列を初期化しない
+void initProgram(uint8_t flgKeep) {
   // 変数と配列の初期化
-  memset(var,0,52);
-  memset(arr,0,SIZE_ARRY*2);
+  if (!flgKeep) {
+    memset(var,0,52);
+    memset(arr,0,SIZE_ARRY*2);
+  }
   gstki = 0;         // GOSUBスタックインデクスを0に初期化
   lstki = 0;         // FORスタックインデクスを0に初期化
   clp = listbuf;     // 行ポインタをプログラム保存領域の先頭に設定
   cip = clp+3;       // 中間コードポインタを先頭に設定
   val_if = 1;        // if文判定結果の初期化
+#if USE_SNAPSHOT != 0
+  flgResume = 0;     // RESUMEによる再開フラグのクリア
+#endif
 }
 
 // RUNコマンド
-void irun() {
+// RUN [VAR]  (VAR指定時は変数と配列を保持して実行)
+// 引数
+//  flgKeep  0:初期化して実行 1:変数と配列を初期化しない
+//           2:初期化せずに現在の実行位置(clp,cip)から実行(RESUME)
+//  start    実行開始行ポインタ(NULLの場合は先頭行から実行)
+void irun(uint8_t flgKeep, uint8_t* start) {
   uint8_t* lp; // 行ポインタの一時的な記憶場所
-  initProgram();
+  if (flgKeep != 2) {
+    initProgram(flgKeep);
+    if (start)
+      clp = start;   // 指定行から実行
+    cip = clp + 3;   // 中間コードポインタを行番号の後ろに設定
+  }
   c_show_curs(0);    // カーソル消去
   while (*clp) {     // 行ポインタが末尾を指すまで繰り返す
-    cip = clp + 3;   // 中間コードポインタを行番号の後ろに設定
     lp = iexe();     // 中間コードを実行して次の行の位置を得る
     if (err)         // もしエラーを生じたら      
       break;
     clp = lp;        // 行ポインタを次の行の位置へ移動
+    cip = clp + 3;   // 中間コードポインタを行番号の後ろに設定
   }
   c_show_curs(1);    // カーソル表示
+#if PRGBANKNUM > 1
+  listbuf = prgbank[curbank]; // 編集対象のバンクに戻す
+#endif
 #if USE_EVENT == 1
   clerTimerEvent();
   clerExtEvent();
@@ -2527,12 +3095,152 @@ void irun() {
 
 // Command precessor
 // コマンドラインからのコマンド実行
+#if USE_UPLOAD == 1
+// UPLOADのフロー制御
+// 引数
+//  flgStop 0:送信再開 1:送信停止
+static void uploadFlow(uint8_t flgStop) {
+#if RtsPin >= 0
+  digitalWrite(RtsPin, flgStop ? HIGH : LOW);   // RTS(LOW:受信可 HIGH:受信不可)
+#else
+  Serial.write(flgStop ? CHAR_XOFF : CHAR_XON); // XON/XOFF
+#endif
+}
+
+// UPLOAD
+// 端末からのプログラムの一括入力(貼り付け用)
+// ・1行受信する毎にフロー制御で送信を停止し、中間コードへの変換・登録後に再開する
+// ・エコーバック、ラインエディタによる行の再表示は行わない
+// ・[ESC]、[CTRL-C]で終了し、登録行数、受信バイト数、エラー行数と最初のエラーを表示する
+//   (エラーの位置は受信した行の何行目かを表示する)
+// ・行番号のない行はエラーとする
+void iupload() {
+  uint16_t lines = 0;   // 登録行数
+  uint16_t bytes = 0;   // 受信バイト数
+  uint16_t errs  = 0;   // エラー行数
+  uint16_t cnt   = 0;   // 受信行数
+  uint16_t errNo = 0;   // 最初のエラーの受信行位置
+  uint8_t  errCode = 0; // 最初のエラーのエラー番号
+  uint8_t  len = 0;     // 受信中の行の文字数
+  uint8_t  flgOver = 0; // 行の長さ超過
+  uint8_t  c;
+
+#if RtsPin >= 0
+  pinMode(RtsPin, OUTPUT);
+#endif
+  c_puts_P((const char*)F("Upload mode, [ESC] to end"));
+  newline();
+  uploadFlow(0);
+  for (;;) {
+    while (!Serial.available());
+    c = Serial.read();
+    if (c == CHAR_CR || c == '\n' || c == CHAR_ESCAPE || c == CHAR_CTRL_C) {
+      while (len && c_isspace(lbuf[len-1]))  // 末尾の空白を除く
+        len--;
+      if (len) {
+        // 1行の変換・登録(処理中は送信を停止する)
+        uploadFlow(1);
+        lbuf[len] = 0;
+        cnt++;
+        if (flgOver) {
+          err = ERR_IBUFOF;
+        } else {
+          len = toktoi();
+          if (!err) {
+            if (*ibuf == I_NUM) {
+              *ibuf = len;
+              inslist();
+            } else {
+              err = ERR_SYNTAX;         // 行番号のない行
+            }
+          }
+        }
+        if (err) {
+          if (!errs++) {
+            errCode = err;
+            errNo = cnt;
+          }
+          err = 0;
+        } else {
+          lines++;
+        }
+        len = 0;
+        flgOver = 0;
+        uploadFlow(0);
+      }
+      if (c == CHAR_ESCAPE || c == CHAR_CTRL_C)
+        break;
+    } else {
+      bytes++;
+      if (c < 32) {
+        // 制御文字は無視する
+      } else if (len < SIZE_LINE - 1) {
+        lbuf[len++] = c;
+      } else {
+        flgOver = 1;
+      }
+    }
+  }
+  clearlbuf();
+
+  // 結果の表示
+  putnum(lines, 0); c_puts_P((const char*)F(" lines, "));
+  putnum(bytes, 0); c_puts_P((const char*)F(" bytes, "));
+  putnum(errs, 0);  c_puts_P((const char*)F(" errors"));
+  newline();
+  if (errs) {
+    c_puts_P((const char*)pgm_read_word(&errmsg[errCode]));
+    c_puts_P((const char*)F(" at #"));
+    putnum(errNo, 0);
+    newline();
+  }
+}
+#endif
+
 uint8_t icom() {
   uint8_t rc = 1;
   cip = ibuf;       // 中間コードポインタを中間コードバッファの先頭に設定
   //c_show_curs(0);  
   switch (*cip++) { // 中間コードポインタが指し示す中間コードによって分岐
-  case I_RUN:   irun();     break;  // RUN命令
+  case I_RUN:                       // RUN命令
+#if USE_ADATA == 1
+    if (*cip == I_MVAR) {
+      cip++;
+      irun(1);                       // RUN VAR
+    } else
+#endif
+#if USE_PAGEDRUN == 1
+    if (*cip == I_STR) {
+      irunFile();                    // RUN "ファイル名"
+    } else
+#endif
+#if USE_ROMPRG == 1
+    if (*cip == I_ROM) {
+      cip++;
+      irunROM();                     // RUN ROM 番号|"名前"
+    } else
+#endif
+      irun();
+    break;
+#if USE_CHAIN == 1
+  case I_CHAIN:                     // CHAIN命令
+    ichain();
+    if (!err)
+      irun(1, clp);
+    break;
+#endif
+#if USE_SNAPSHOT != 0
+  case I_RESUME:                    // RESUME命令
+    iresume();
+    if (!err)
+      irun(2);                       // 保存時の実行位置から再開
+    break;
+#endif
+#if USE_UPLOAD == 1
+  case I_UPLOAD:                    // UPLOAD命令
+    iupload();
+    break;
+#endif
 
 /* システムコマンドの一部を一般コマンドに変更
   case I_LIST:  ilist();    break;  // LIST
@@ -2569,7 +3277,13 @@ uint8_t icom() {
 void basic() {
   uint8_t len;     // 中間コードの長さ
 
+#if USE_FASTBOOT == 1
+  // 自動起動時は最初の文字出力まで端末への出力を遅延する
+  uint8_t flgFast = digitalRead(AutoPin);
+  init_console(flgFast);  // シリアルコンソールの初期設定
+#else
   init_console();  // シリアルコンソールの初期設定
+#endif
 
 #if USE_CMD_VFD == 1 
   VFD_init();  // VFD利用開始
@@ -2590,17 +3304,31 @@ void basic() {
 #endif
 
   inew(); // 実行環境を初期化
-  icls(); // 画面クリア
-  //起動メッセージ
-  c_puts_P((const char*)F(STR_EDITION_));
-  putnum(getsize(),3); c_puts_P((const char*)F("byte free\n")); //プログラム領域を表示
-  error(); //「OK」またはエラーメッセージを表示してエラー番号をクリア
+#if USE_FASTBOOT == 1
+  if (!flgFast)  // 高速起動時は起動メッセージを省略
+#endif
+  {
+    icls(); // 画面クリア
+    //起動メッセージ
+    c_puts_P((const char*)F(STR_EDITION_));
+    putnum(getsize(),3); c_puts_P((const char*)F("byte free\n")); //プログラム領域を表示
+    error(); //「OK」またはエラーメッセージを表示してエラー番号をクリア
+  }
   
   // リセット時に指定PINがHIGHの場合、プログラム自動起動
   if (digitalRead(AutoPin)) {
+    uint8_t flgKeep = 0;         // 0:先頭から実行 2:スナップショットの実行位置から再開
+#if USE_SNAPSHOT == 2
+    if (autoResume())
+      flgKeep = 2;
+    else
+#endif
     // ロードに成功したら、プログラムを実行する
     iLoadSave(MODE_LOAD,true);   // プログラムのロード
-    irun();                      // RUN命令を実行
+#if USE_FASTBOOT == 1 && USE_SYSINFO == 1
+    bootTime = micros();         // 起動から最初の文の実行までの時間
+#endif
+    irun(flgKeep);               // RUN命令を実行
     newline();                   // 改行
     error();                     // エラーメッセージ出力
     err = 0; 
@@ -10,6 +10,20 @@
 // 修正 2019/08/12 SLEEP機能の追加(SLEEPコマンド)
 // 修正 2019/10/08 NeoPixelのエラーメッセージの追加
 // 修正 2019/11/01 Else単独記述時、直前のIf判定結果で実行する機能の追加
+// 修正 2026/10/19 内部EEPROMの保存データ破損エラーの追加
+// 修正 2026/10/19 内部EEPROMへのバックグラウンド保存対応
+// 修正 2026/10/19 ERASEの消去オプション(WIPE)の追加
+// 修正 2026/10/19 I2C EEPROMの詰め直し(COMPACTコマンド)の追加
+// 修正 2026/10/19 I2C EEPROMのデータファイル(OPEN,WRITE#,READ#,FLUSH,CLOSE,LOF())の追加
+// 修正 2026/10/19 配列・変数の保存・読込み(ASAVE,ALOAD)、RUN VARの追加
+// 修正 2026/10/19 プログラムの連結実行(CHAIN)の追加
+// 修正 2026/10/19 I2C EEPROMのプログラムのページ実行(RUN "ファイル名")の追加
+// 修正 2026/10/19 プログラム領域のバンク(BANK、CALL BANK)の追加
+// 修正 2026/10/19 ROMプログラム(RUN ROM,LOAD ROM,SAVE ROM,FILES ROM)の追加
+// 修正 2026/10/19 実行状態の保存・復元(SNAPSHOT、RESUME)の追加
+// 修正 2026/10/19 プログラムの不要部分の削除(PACK)の追加
+// 修正 2026/10/19 プログラムの一括入力(UPLOAD)の追加
+// 修正 2026/10/19 追加したキーワードを機能の利用設定で有効化するように変更
 //
 
 #ifndef __basic_h__
@@ -129,6 +143,48 @@ enum {
 // タイマー・外部割込みイベントの利用
 #if USE_EVENT == 1 || USE_ALL_KEYWORD == 1
   I_TIMER, I_PIN, I_SLEEP,
+#endif
+// EEPROMの保存管理
+#if USE_ERASEWIPE == 1 || USE_ALL_KEYWORD == 1
+  I_WIPE,
+#endif
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 || USE_ALL_KEYWORD == 1
+  I_COMPACT,
+#endif
+#if USE_DATAFILE == 1 || USE_ALL_KEYWORD == 1
+  I_FOPEN,
+#endif
+#if USE_DATAFILE == 1 || USE_PAGEDRUN == 1 || USE_ALL_KEYWORD == 1
+  I_APPEND,
+#endif
+#if USE_DATAFILE == 1 || USE_ALL_KEYWORD == 1
+  I_WRITE, I_READ, I_FLUSH, I_FCLOSE, I_LOF,
+#endif
+#if USE_ADATA == 1 || USE_ALL_KEYWORD == 1
+  I_ASAVE, I_ALOAD,
+#endif
+#if USE_CHAIN == 1 || USE_ALL_KEYWORD == 1
+  I_CHAIN,
+#endif
+// プログラムバンク
+#if PRGBANKNUM > 1 || USE_ALL_KEYWORD == 1
+  I_BANK, I_CALL,
+#endif
+// ROMプログラム
+#if USE_ROMPRG == 1 || USE_ALL_KEYWORD == 1
+  I_ROM,
+#endif
+// 実行状態の保存・復元
+#if USE_SNAPSHOT != 0 || USE_ALL_KEYWORD == 1
+  I_SNAPSHOT, I_RESUME,
+#endif
+// プログラムの不要部分の削除
+#if USE_PACK == 1 || USE_ALL_KEYWORD == 1
+  I_PACK,
+#endif
+// プログラムの一括入力
+#if USE_UPLOAD == 1 || USE_ALL_KEYWORD == 1
+  I_UPLOAD,
 #endif
   I_OK, 
   I_NUM, I_VAR, I_STR, I_HEXNUM, I_BINNUM,
@@ -168,6 +224,8 @@ enum {
 #if USE_NEOPIXEL == 1 || USE_ALL_KEYWORD == 1
   ERR_NINIT,
 #endif
+  ERR_CHKSUM,
+  ERR_FNOPEN,
 };
 
 // GOTO/GOSUBモード
@@ -182,13 +240,19 @@ extern int16_t errorLine;            // 直前のエラー発生行番号
 extern int16_t arr[SIZE_ARRY];       // 配列変数領域
 extern int16_t var[26];              // 変数領域（A-Z×2バイト)
 extern uint8_t lbuf[SIZE_LINE];      // コマンドラインバッファ
+#if PRGBANKNUM > 1
+extern uint8_t* listbuf;             // プログラム領域(選択中のバンク)
+#else
 extern uint8_t listbuf[SIZE_LIST];   // プログラム領域
+#endif
 extern uint8_t* cip;                 // インタプリタ中間コード参照位置
 extern uint8_t* clp;                 // カレント行先頭ポインタ
 extern uint8_t prevPressKey;         // 直前入力キーの値(INKEY()、[ESC]中断キー競合防止用)
 extern uint8_t val_if;              // if文判定結果
 extern uint8_t gstki;               // GOSUB スタック インデックス
 extern uint8_t lstki;               // FOR 市タック インデックスtoktoi()
+extern uint8_t* gstk[SIZE_GSTK];    // GOSUB スタック
+extern uint8_t* lstk[SIZE_LSTK];    // FOR スタック
 
 //*** 関数のプロトタイプ宣言 **********************
 
@@ -229,17 +293,27 @@ char* getLineStr(int16_t lineno);
 char* tlimR(char* str);
 char c_isspace(char c);
 char c_isdigit(char c);
+char c_isalpha(char c);
 void putlist(uint8_t* ip, uint8_t devno=0);
 void inew(void);
 void putHexnum(int16_t value, uint8_t d, uint8_t devno);
 uint8_t* getJumplp();
 void iGotoGosub(uint8_t mode, uint16_t evtlp = 0);
-void irun();
-void initProgram();
+void irun(uint8_t flgKeep=0, uint8_t* start=NULL);
+void initProgram(uint8_t flgKeep=0);
+uint8_t* iexe();
+uint8_t isPrgArea(uint8_t* p);
+#if PRGBANKNUM > 1
+void ibank();
+void icallbank();
+void setBank(uint8_t* lp);
+#endif
 
 // コンソール画面関連
-void init_console();
+void init_console(uint8_t flgDefer = 0);
 uint8_t* getlp(short lineno);
+int16_t getsize();
+uint8_t checkList(uint8_t* lp, uint16_t size);
 int16_t getlineno(uint8_t *lp);
 int16_t getPrevLineNo(int16_t lineno) ;
 int16_t getNextLineNo(int16_t lineno);
@@ -281,6 +355,38 @@ void ipoke();
 #define MODE_LOAD 0
 #define MODE_SAVE 1
 void iLoadSave(uint8_t mode,uint8_t flgskip=0);
+void iAData(uint8_t mode);
+void ichain();
+void irunFile();
+void ipack();
+uint16_t packList(uint8_t* dst, uint16_t limit);
+#if USE_SNAPSHOT != 0
+extern uint8_t flgResume;            // RESUMEによる再開フラグ
+void isnapshot();
+void iresume();
+int16_t iresumestat();
+uint8_t autoResume();
+#endif
+
+// ページ実行
+#if USE_PAGEDRUN == 1
+uint8_t isPaged();
+uint8_t checkPaged();
+void pgRun(uint8_t* fname);
+uint8_t* pgGetlp(int16_t lineno);
+uint8_t* pgGetlpByLabel(uint8_t* pLabel);
+void pgInfo();
+#if USE_ROMPRG == 1
+void irunROM();
+void iloadROM();
+void isaveROM();
+void ifilesROM();
+#endif
+#else
+#define checkPaged() 0
+#endif
+void waitSave();
+int16_t isavestat();
 uint8_t getFname(uint8_t* fname, uint8_t limit);
 void ierase();
 void ifiles();
@@ -298,6 +404,13 @@ void ivdisplay();
 int16_t ii2cw();
 int16_t ii2cr();
 void iformat();
+void icompact();
+void iopen();
+void iwrite();
+void iread();
+void iflush();
+void iclose();
+int16_t ilof();
 void iefiles();
 void iedel();
 void idrive();
@@ -361,6 +474,20 @@ void inscroll();
 int16_t inpoint();
 
 // タイマーイベント
+// イベント設定の保存データ(SNAPSHOT)
+// (飛び先はプログラム領域先頭からの位置)
+typedef struct {
+  int16_t  period;      // タイマー周期
+  uint8_t  tactive;     // タイマー割り込み実行状態
+  uint8_t  taction;     // タイマー 0:未登録 1:GOTO 2:GOSUB
+  uint16_t tparam;      // タイマー 飛び先
+  uint8_t  emode[2];    // 外部割込み 検出モード
+  uint8_t  epmode[2];   // 外部割込み ピンモード
+  uint8_t  eactive[2];  // 外部割込み 実行状態
+  uint8_t  eaction[2];  // 外部割込み 0:未登録 1:GOTO 2:GOSUB
+  uint16_t eparam[2];   // 外部割込み 飛び先
+} evtsnap_t;
+
 void iOnPinTimer();
 void iTimer();
 void initTimerEvent();
@@ -368,6 +495,9 @@ void clerTimerEvent();
 void doTimerEvent();
 
 void clerExtEvent();
+uint8_t isEventLine(uint8_t* top, uint8_t* end);
+uint8_t evtSave(evtsnap_t* e);
+void evtRestore(evtsnap_t* e);
 void doExtEvent();
 void iPin();
 void isleep();
@@ -4,6 +4,7 @@
 // 作成 2019/06/08 by たま吉さん 
 // 修正 2019/06/30 ライン先頭全角文字のカーソル移動ミス対応、line_movePrevChar()の不具合修正
 // 修正 2019/11/14 c_gets():[BS]キーでの全角文字の処理不具合対応
+// 修正 2026/10/19 高速起動時の端末初期化の遅延対応
 //
 
 #include "Arduino.h"
@@ -19,6 +20,31 @@ void Arduino_putchar(uint8_t c) {
   Serial.write(c);
 }
 
+#if USE_FASTBOOT == 1
+// 端末初期化の遅延(高速起動時)
+// 初期化時の出力シーケンスを記録しておき、最初の文字出力時にまとめて送信する
+#define SIZE_INITSEQ 24
+uint8_t flgConsoleDefer = 0;       // 端末出力遅延中フラグ
+uint8_t initseq[SIZE_INITSEQ];     // 初期化シーケンス
+uint8_t initseq_len = 0;           // 初期化シーケンス長
+
+// 初期化シーケンスの記録(mcursesから利用）
+void Arduino_recchar(uint8_t c) {
+  if (initseq_len < SIZE_INITSEQ)
+    initseq[initseq_len++] = c;
+}
+
+// 最初の1文字出力(mcursesから利用）
+void Arduino_firstchar(uint8_t c) {
+  setFunction_putchar(Arduino_putchar);
+  flgConsoleDefer = 0;
+  Serial.write(initseq, initseq_len);  // 遅延していた初期化シーケンスの送信
+  if (!flgCurs)
+    curs_set(0);                       // 遅延していたカーソル非表示の反映
+  Serial.write(c);
+}
+#endif
+
 // シリアル経由1文字入力(mcursesから利用）
 char Arduino_getchar() {
   while (!Serial.available());
@@ -54,17 +80,35 @@ void c_newLine() {
 }
 
 // コンソール初期化
-void init_console() {
+// 引数
+//  flgDefer 0:通常 1:最初の文字出力まで端末への出力を遅延する(高速起動)
+void init_console(uint8_t flgDefer) {
   // mcursesの設定
+#if USE_FASTBOOT == 1
+  if (flgDefer) {
+    flgConsoleDefer = 1;
+    flgCurs = 1;
+    initseq_len = 0;
+    setFunction_putchar(Arduino_recchar);  // 初期化シーケンスは記録のみ
+  } else
+#endif
   setFunction_putchar(Arduino_putchar);  // 依存関数
   setFunction_getchar(Arduino_getchar);  // 依存関数
   initscr();                             // 依存関数
   setscrreg(0,MCURSES_LINES);  
+#if USE_FASTBOOT == 1
+  if (flgConsoleDefer)
+    setFunction_putchar(Arduino_firstchar);
+#endif
 }
 
 // カーソル表示制御
 void c_show_curs(uint8_t mode) {
   flgCurs = mode;
+#if USE_FASTBOOT == 1
+  if (flgConsoleDefer)
+    return;  // 端末出力遅延中は状態のみ保持
+#endif
   curs_set(mode);
 }
 
@@ -4,6 +4,22 @@
 // 2019/06/08 by たま吉さん 
 // 修正 2019/07/27 LOADコマンドのエラーコード不具合対応
 // 修正 2019/09/11 LOADでプログラム中で別プログラムをロード実行可能
+// 修正 2026/10/19 内部EEPROMからのLOADはプログラム利用領域のみ読み込むように修正
+// 修正 2026/10/19 内部EEPROMの保存をディレクトリ管理の可変長に変更(データ長、CRCチェック対応)
+// 修正 2026/10/19 内部EEPROMへのSAVEをバックグラウンド書込みに変更(SAVE ... WAIT、SAVE()関数の追加)
+// 修正 2026/10/19 ERASEをディレクトリの無効化のみに変更、消去オプション(WIPE)の追加
+// 修正 2026/10/19 内部EEPROMのウェアレベリング対応(USE_EEPROM_WL)
+// 修正 2026/10/19 I2C EEPROMの可変長ファイル対応(利用分のみ保存)、FORMATの128/256kバイト対応、COMPACTコマンドの追加
+// 修正 2026/10/19 プログラム保存時の圧縮対応(USE_PRGCOMP)
+// 修正 2026/10/19 I2C EEPROMのデータファイル対応(OPEN,WRITE#,READ#,FLUSH,CLOSE,LOF())(USE_DATAFILE)
+// 修正 2026/10/19 配列・変数の保存・読込み(ASAVE,ALOAD)の追加
+// 修正 2026/10/19 変数を保持したプログラムの連結実行(CHAIN)の追加
+// 修正 2026/10/19 I2C EEPROMのプログラムの追記保存(SAVE ... APPEND)、実行(RUN "ファイル名")の追加(USE_PAGEDRUN)
+// 修正 2026/10/19 ROMプログラムのロード(LOAD ROM)、出力(SAVE ROM)、一覧表示(FILES ROM)の追加(USE_ROMPRG)
+// 修正 2026/10/19 実行状態の保存・復元(SNAPSHOT、RESUME)の追加(USE_SNAPSHOT)
+// 修正 2026/10/19 プログラムの不要部分を削除した保存(PACK)の追加
+// 修正 2026/10/19 ロード、RESUME時の中間コードの構成が異なる保存データの検出
+// 修正 2026/10/19 プログラムファイルへのOPEN FOR APPENDを値の異常エラーとするように修正
 
 #include "Arduino.h"
 #include "basic.h"
@@ -12,84 +28,317 @@
 #if USE_CMD_I2C == 1 && USE_I2CEEPROM == 1
   #include "src/lib/TI2CEEPROM.h"
   TI2CEEPROM rom(0x50);  // I2Cスレーブアドレスは0x50
+ #if USE_DATAFILE == 1
+  static ti2ceeprom_file_t dfile = { TI2CEEPROM_FCLOSED };  // オープン中のデータファイル
+
+// データファイル操作の戻り値のエラー設定
+static void dataErr(uint8_t rc) {
+  if (rc == 1)
+    err = ERR_I2CDEV;   // I2Cデバイスエラー
+  else if (rc == 2)
+    err = ERR_FNAME;    // 該当ファイルなし
+  else if (rc == 3)
+    err = ERR_NOFSPACE; // 保存領域なし
+  else if (rc == 4)
+    err = ERR_VALUE;    // ファイル種別が異なる(プログラムファイルへの追記等)
+}
+
+// データファイルのクローズ
+// (保存、削除、詰め直し等の前に書込みバッファを書き込んでクローズする)
+// 引数
+//  fname : 対象ファイル名(NULLの場合は無条件にクローズする)
+static void closeData(uint8_t* fname) {
+  if (dfile.index != TI2CEEPROM_FCLOSED && (!fname || rom.find(fname) == dfile.index))
+    dataErr(rom.close(&dfile));
+}
+ #endif
 #endif
 
 // *** 内部EEPROMフラッシュメモリ管理 ***************
-#include <avr/eeprom.h>
-#if defined(ARDUINO_AVR_MEGA2560) || defined(ARDUINO_AVR_ATmega1284)
-  #if PRGAREASIZE <= 512
-    #define EEPROM_PAGE_NUM         8      // 全ページ数
-    #define EEPROM_PAGE_SIZE        512    // ページ内バイト数
-    #define EEPROM_SAVE_NUM         8      // プログラム保存可能数
-  #elif PRGAREASIZE <= 1024
-    #define EEPROM_PAGE_NUM         4      // 全ページ数
-    #define EEPROM_PAGE_SIZE        1024   // ページ内バイト数
-    #define EEPROM_SAVE_NUM         5      // プログラム保存可能数
-  #elif PRGAREASIZE <= 2048
-    #define EEPROM_PAGE_NUM         2      // 全ページ数
-    #define EEPROM_PAGE_SIZE        2048   // ページ内バイト数
-    #define EEPROM_SAVE_NUM         2      // プログラム保存可能数
-  #elif PRGAREASIZE <= 4096
-    #define EEPROM_PAGE_NUM         1      // 全ページ数
-    #define EEPROM_PAGE_SIZE        4096   // ページ内バイト数
-    #define EEPROM_SAVE_NUM         1      // プログラム保存可能数
-  #endif
-#else
-  #if PRGAREASIZE <= 512
-    #define EEPROM_PAGE_NUM         2      // 全ページ数
-    #define EEPROM_PAGE_SIZE        512    // ページ内バイト数
-    #define EEPROM_SAVE_NUM         2      // プログラム保存可能数
-  #elif PRGAREASIZE <= 1024
-    #define EEPROM_PAGE_NUM         1      // 全ページ数
-    #define EEPROM_PAGE_SIZE        1024   // ページ内バイト数
-    #define EEPROM_SAVE_NUM         1      // プログラム保存可能数
-  #endif
+#include "src/lib/TEEPROM.h"
+#include <util/crc16.h>
+TEEPROM eep(USE_EEPROM_WL);  // 保存番号毎に可変長で保存(ディレクトリでデータ長・CRCを管理)
+#define EEPROM_SAVE_NUM  TEEPROM_SLOTNUM  // プログラム保存可能数
+
+// 配列・変数の保存データ(ASAVE)の識別子
+// (先頭バイトはプログラムの行長、圧縮データ識別子と重ならない値とする)
+#define ADATA_SIGN   0xFE  // 先頭バイト
+#define ADATA_ARRAY  'A'   // 種別:配列
+#define ADATA_VAR    'V'   // 種別:変数
+#define ADATA_SNAP   'S'   // 種別:実行状態(SNAPSHOT)
+#define ADATA_HEAD   2     // ヘッダーサイズ(識別子+種別)
+#define PRG_HEAD     3     // ロード時に判定に使う先頭バイト数
+
+// *** プログラムの圧縮保存 ***************
+#if USE_PRGCOMP == 1
+#include "src/lib/TLZSS.h"
+static uint8_t  lzPrgno;  // 伸長中の保存番号
+ #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+static uint8_t* lzFname;  // 伸長中のファイル名
+ #endif
+
+// 圧縮データ読込み(内部EEPROM)
+static uint8_t lzReadEEP(uint16_t pos, uint8_t* buf, uint8_t len) {
+  return eep.read(lzPrgno, pos, buf, len);
+}
+
+ #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+// 圧縮データ読込み(I2C EEPROM)
+static uint8_t lzReadROM(uint16_t pos, uint8_t* buf, uint8_t len) {
+  return rom.load(lzFname, pos, buf, len);
+}
+ #endif
+
+// プログラムの圧縮
+// プログラム領域の空き部分に圧縮データを作成する
+// (圧縮データが元より小さくならない、空き部分に収まらない場合は圧縮しない)
+// 引数
+//  len : 保存データ長(圧縮した場合は圧縮データ長に更新)
+// 戻り値
+//  保存データの先頭アドレス
+static uint8_t* packProgram(uint16_t& len) {
+  uint16_t sz = SIZE_LIST - len;
+  uint16_t clen;
+  if (sz > len - 1)
+    sz = len - 1;  // 元より小さくなる場合のみ圧縮する
+  uint8_t* dst = listbuf + len;
+  if ( !(clen = TLZSS::encode(listbuf, len, dst, sz)) )
+    return listbuf;
+  len = clen;
+  return dst;
+}
+#endif
+
+// 内部EEPROMへの保存処理の完了待ち
+// (プログラム領域を変更する処理の前に呼び出すこと)
+void waitSave() {
+  eep.flush();
+}
+
+// 内部EEPROMへの保存処理の残りバイト数
+// SAVE()
+int16_t isavestat() {
+  if (checkOpen()||checkClose()) return 0;
+  return eep.busy();
+}
+
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+// プログラムのロード(I2C EEPROM)
+// (ファイルサイズ分のみ読み込む、エラーはerrに設定する)
+// 引数
+//  fname : ファイル名
+static void loadROM(uint8_t* fname) {
+  uint8_t  rc;
+  uint8_t  head[PRG_HEAD];                         // 保存データの種別判定用
+#if USE_PRGCOMP == 1
+  uint16_t olen;
+#endif
+  *head = 0;
+  if ( (rc = rom.load(fname, 0, head, PRG_HEAD)) ) {
+    ;                                              // 該当ファイルなし、I2Cデバイスエラー
+  } else if (*head == ADATA_SIGN) {
+    rc = 5;                                        // 配列・変数の保存データ
+#if USE_PRGCOMP == 1
+  } else if ( (olen = TLZSS::size(head)) ) {
+    // 圧縮データをプログラム領域に伸長する
+    TLZSS lz;
+    lzFname = fname;
+    if (olen > SIZE_LIST) {
+      rc = 3;                                      // プログラム領域に収まらない
+    } else if (lz.decode(lzReadROM, listbuf, olen)) {
+      *listbuf = 0;
+      rc = 4;                                      // 圧縮データ破損
+    }
+#endif
+  } else if (rom.fileSize(fname) > SIZE_LIST) {
+    rc = 3;                                        // プログラム領域に収まらない
+  } else {
+    rc = rom.load(fname, 0, listbuf, SIZE_LIST);   // プログラムのロード
+  }
+  if (!rc && checkList(listbuf, SIZE_LIST)) {
+    *listbuf = 0;
+    rc = 5;                                        // プログラムの形式が異なる
+  }
+  if (rc == 2)
+    err = ERR_FNAME;
+  else if (rc == 3)
+    err = ERR_LBUFOF;
+  else if (rc == 4)
+    err = ERR_CHKSUM;
+  else if (rc == 5)
+    err = ERR_VALUE;
+  else if (rc)
+    err = ERR_I2CDEV;
+}
+#endif
+
+#if USE_PAGEDRUN == 1
+// プログラムの追記保存(I2C EEPROM)
+// ページ実行用に、プログラム領域を超えるプログラムを分割して作成する
+// (圧縮せずに終端を含めて追記する、行番号は既存の行より後であること(RUN実行時にチェック))
+// 引数
+//  fname : ファイル名
+static void appendROM(uint8_t* fname) {
+  ti2ceeprom_file_t f;
+  uint8_t head[PRG_HEAD];
+  uint8_t rc, rc2;
+
+  if (!*fname) {
+    err = ERR_FNAME;
+    return;
+  }
+  if ( !(rc = rom.open(&f, fname, 1, TI2CEEPROM_F_PRG)) ) {
+    if (f.len >= PRG_HEAD && !(rc = rom.readData(&f, 0, head, PRG_HEAD))) {
+      if (*head == ADATA_SIGN)
+        rc = 4;                // 配列・変数の保存データ
+ #if USE_PRGCOMP == 1
+      else if (TLZSS::size(head))
+        rc = 4;                // 圧縮データ
+ #endif
+    }
+    if (!rc)
+      rc = rom.append(&f, listbuf, SIZE_LIST - getsize());
+    rc2 = rom.close(&f);
+    if (!rc)
+      rc = rc2;
+  }
+  if (rc == 4)
+    err = ERR_VALUE;           // プログラムファイル以外、追記できないデータ
+  else if (rc == 3)
+    err = ERR_NOFSPACE;
+  else if (rc)
+    err = ERR_I2CDEV;
+}
 #endif
 
+// プログラムのロード(内部EEPROM)
+// (保存データ長分のみ読み込む、エラーはerrに設定する)
+// 引数
+//  prgno : 保存番号
+static void loadEEP(uint8_t prgno) {
+  uint8_t rc;
+  uint8_t head[PRG_HEAD];  // 保存データの種別判定用
+#if USE_PRGCOMP == 1
+  uint16_t olen;
+#endif
+  *head = 0;
+  eep.read(prgno, 0, head, PRG_HEAD);
+  if (*head == ADATA_SIGN) {
+    rc = 4;                // 配列・変数の保存データ
+  } else
+#if USE_PRGCOMP == 1
+  if ( (olen = TLZSS::size(head)) ) {
+    // 圧縮データをCRCチェック後にプログラム領域に伸長する
+    TLZSS lz;
+    lzPrgno = prgno;
+    if ( !(rc = eep.check(prgno)) && (olen > SIZE_LIST || lz.decode(lzReadEEP, listbuf, olen)) )
+      rc = 1;
+  } else
+#endif
+  rc = eep.load(prgno, listbuf, SIZE_LIST);
+  switch (rc) {
+  case 0:
+    if (checkList(listbuf, SIZE_LIST)) {
+      *listbuf = 0; err = ERR_VALUE;            // プログラムの形式が異なる
+    }
+    break;
+  case 2: *listbuf = 0; break;                  // 未保存の場合は空のプログラムとする
+  case 4: err = ERR_VALUE; break;               // プログラム以外の保存データ
+  default: *listbuf = 0; err = ERR_CHKSUM; break; // 保存データ破損
+  }
+}
+
 // プログラムロード/セーブ
 // LOAD 保存領域番号|"ファイル名"
-// SAVE 保存領域番号|"ファイル名"
+// SAVE 保存領域番号|"ファイル名" [WAIT|APPEND]
+//  ※内部EEPROMへのSAVEはバックグラウンドで書込みを行う(WAIT指定時は書込み完了を待つ)
+//    APPEND指定時はI2C EEPROMのファイルに追記する(ページ実行用)
 // 引数
 //  mode     0:ロード、0以外:セーブ
 //  flgskip  0:引数チェック有効、0以外 引数チェック無効（自動起動ロード時利用）
 //
 void iLoadSave(uint8_t mode,uint8_t flgskip) {
   int16_t  prgno = 0;  // プログラム番号
-  uint16_t topAddr;    // EEPROMアドレス
+
+  if (!mode)
+    waitSave();  // ロード先のプログラム領域が保存中の場合は完了を待つ
 
   // 引数がファイル名かのチェック
+#if USE_ROMPRG == 1
+  if (*cip == I_ROM) {
+    // ROMプログラムのロード/定義形式での出力
+    cip++;
+    if (mode) {
+      isaveROM();
+      return;
+    }
+    iloadROM();
+  } else
+#endif
 #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
   if (*cip == I_STR) {
 
     // 外部接続I2C EEPROMへロード/セーブ処理
     uint8_t fname[TI2CEEPROM_FNAMESIZ+1];
-    uint8_t rc;   
     if (getFname(fname, TI2CEEPROM_FNAMESIZ)) return;  // ファイル名の取得
     if (mode) {
-      rc = rom.save(fname, 0, listbuf, SIZE_LIST);     // プログラムのセーブ  
+      uint8_t rc;
+      if (!*fname) {
+        err = ERR_FNAME;                               // 空のファイル名
+        return;
+      }
+ #if USE_DATAFILE == 1
+      closeData(fname);                                // 保存先がオープン中のデータファイルの場合はクローズ
+      if (err) return;
+ #endif
+#if USE_PAGEDRUN == 1
+      if (*cip == I_APPEND) {
+        cip++;
+        appendROM(fname);                              // プログラムの追記
+        return;
+      }
+#endif
+      uint16_t len = SIZE_LIST - getsize();            // 保存データ長(利用分のみ)
+      uint8_t* ptr = listbuf;
+#if USE_PRGCOMP == 1
+      ptr = packProgram(len);                          // 圧縮可能な場合は圧縮データを保存
+#endif
+      rc = rom.save(fname, ptr, len, TI2CEEPROM_F_PRG); // プログラムのセーブ
+      if (rc == 2)
+        err = ERR_NOFSPACE;
+      else if (rc)
+        err = ERR_I2CDEV;
+      if (*cip == I_WAIT)
+        cip++;   // I2C EEPROMへの保存は常に書込み完了を待つ
     } else {
-      rc = rom.load(fname, 0, listbuf, SIZE_LIST);     // プログラムのロード
+      loadROM(fname);                                  // プログラムのロード
     }
-    if (rc == 2)
-      err = mode? ERR_NOFSPACE :ERR_FNAME;
-    else if (rc)
-      err = ERR_I2CDEV;
   } else 
  #endif 
   {
     // 内部EEPROMメモリへロード/セーブ処理
     if (!flgskip) {
-      if (*cip == I_EOL) {
+      if (*cip == I_EOL || *cip == I_COLON || *cip == I_WAIT) {
         prgno = 0; // 引数省略時はプログラム番号を0とする
       } else if ( getParam(prgno, 0, EEPROM_SAVE_NUM-1, false) ) {
         return ;    // 引数エラー
       }
     }    
-    topAddr = EEPROM_PAGE_SIZE*prgno;
-    if (mode)
-      eeprom_update_block((void *)listbuf, (void *)topAddr, SIZE_LIST);  // プログラムのセーブ  
-    else
-      eeprom_read_block((void *)listbuf, (void *)topAddr, SIZE_LIST);    // プログラムのロード      
+    if (mode) {
+      // プログラムのセーブ(終端までの利用分のみ)
+      uint8_t flgWait = (*cip == I_WAIT);
+      if (flgWait)
+        cip++;
+      uint16_t len = SIZE_LIST - getsize();
+      uint8_t* ptr = listbuf;
+#if USE_PRGCOMP == 1
+      ptr = packProgram(len);  // 圧縮可能な場合は圧縮データ(プログラム領域の空き部分)を保存
+#endif
+      if (eep.save(prgno, ptr, len, flgWait))
+        err = ERR_NOFSPACE;
+    } else {
+      loadEEP(prgno);          // プログラムのロード
+    }
   }
 
   // LOADのプログラム中での実行では、ロードしたプログラムを実行する
@@ -97,14 +346,577 @@ void iLoadSave(uint8_t mode,uint8_t flgskip) {
     initProgram();
 }
 
+#if USE_CHAIN == 1
+// プログラムの連結実行
+// CHAIN 保存番号|"ファイル名"[,行番号]
+//  ※変数・配列を保持したまま、指定したプログラムをロードして実行する
+//    (行番号指定時は指定行から実行、GOSUB・FORのスタック、イベント設定は初期化する)
+//    引数はロード前に全て評価する(ロード後は元のプログラムを参照できないため)
+void ichain() {
+  static const uint8_t eol = I_EOL;  // 空プログラム実行時の中間コード
+  int16_t  prgno;
+  int16_t  lineno = -1;
+  uint8_t* lp;
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+  uint8_t  fname[TI2CEEPROM_FNAMESIZ+1];
+  *fname = 0;
+  if (*cip == I_STR) {
+    if (getFname(fname, TI2CEEPROM_FNAMESIZ))
+      return;
+    if (!*fname) {
+      err = ERR_FNAME;
+      return;
+    }
+  } else
+#endif
+  if ( getParam(prgno, 0, EEPROM_SAVE_NUM-1, false) )
+    return;
+  if (*cip == I_COMMA) {
+    cip++;
+    if ( getParam(lineno, 1, 32767, false) )
+      return;
+  }
+
+  // プログラムのロード
+  waitSave();
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+  if (*fname)
+    loadROM(fname);
+  else
+#endif
+  loadEEP(prgno);
+  if (err)
+    return;
+
+  // 実行開始位置の設定
+  lp = listbuf;
+  if (lineno > 0) {
+    lp = getlp(lineno);
+    if (lineno != getlineno(lp)) {
+      for (clp = listbuf; *clp; clp += *clp);  // 元のプログラムは無いため、エラー行は表示しない
+      err = ERR_ULN;
+      return;
+    }
+  }
+  initProgram(1);
+#if USE_EVENT == 1
+  clerTimerEvent();
+  clerExtEvent();
+#endif
+  clp = lp;
+  cip = *clp ? clp+3 : (uint8_t*)&eol;
+}
+#endif
+
+#if USE_PAGEDRUN == 1
+// I2C EEPROMのプログラムの実行
+// RUN "ファイル名"
+//  ※圧縮保存したプログラムはプログラム領域にロードして実行し、それ以外はページ実行する
+void irunFile() {
+  uint8_t fname[TI2CEEPROM_FNAMESIZ+1];
+  uint8_t head[PRG_HEAD];
+  uint8_t rc;
+
+  if (getFname(fname, TI2CEEPROM_FNAMESIZ))
+    return;
+  *head = 0;
+  if ( (rc = rom.load(fname, 0, head, PRG_HEAD)) ) {
+    err = (rc == 2) ? ERR_FNAME : ERR_I2CDEV;
+  } else if (*head == ADATA_SIGN) {
+    err = ERR_VALUE;           // 配列・変数の保存データ
+ #if USE_PRGCOMP == 1
+  } else if (TLZSS::size(head)) {
+    waitSave();
+    loadROM(fname);
+    if (!err)
+      irun();
+ #endif
+  } else {
+    pgRun(fname);              // ページ実行
+  }
+}
+#endif
+
+#if USE_PACK == 1
+// プログラムの不要部分の削除
+// PACK [保存番号|"ファイル名"]
+//  ※保存先省略時はプログラム領域のプログラムを変換する(プログラム中では利用不可)
+//    保存先指定時は、変換したプログラムをプログラム領域の空き部分に作成して保存し、
+//    プログラム領域のプログラムは変更しない(空き部分に収まらない場合はエラー)
+//    変換内容はpackList()を参照、削減したバイト数を表示する
+void ipack() {
+  int16_t  prgno = -1;
+  uint16_t len = SIZE_LIST - getsize();  // 変換前のプログラム長
+  uint16_t plen;                         // 変換後のプログラム長
+  uint8_t* dst;
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+  uint8_t  fname[TI2CEEPROM_FNAMESIZ+1];
+  *fname = 0;
+  if (*cip == I_STR) {
+    if (getFname(fname, TI2CEEPROM_FNAMESIZ))
+      return;
+    if (!*fname) {
+      err = ERR_FNAME;
+      return;
+    }
+  } else
+#endif
+  if (*cip != I_EOL && *cip != I_COLON) {
+    if ( getParam(prgno, 0, EEPROM_SAVE_NUM-1, false) )
+      return;
+  }
+
+  waitSave();
+  if (prgno < 0
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+      && !*fname
+#endif
+     ) {
+    // プログラム領域上で変換する
+    if (cip >= listbuf && cip < listbuf + SIZE_LIST) {
+      err = ERR_COM;  // 実行中のプログラムは変換できない
+      return;
+    }
+    if ( !(plen = packList(listbuf, SIZE_LIST)) )
+      return;
+  } else {
+    // 空き部分に作成して保存する
+    dst = listbuf + len;
+    if ( !(plen = packList(dst, SIZE_LIST - len)) )
+      return;
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+    if (*fname) {
+      uint8_t rc;
+ #if USE_DATAFILE == 1
+      closeData(fname);
+      if (err) return;
+ #endif
+      if ( (rc = rom.save(fname, dst, plen, TI2CEEPROM_F_PRG)) )
+        err = (rc == 2) ? ERR_NOFSPACE : ERR_I2CDEV;
+    } else
+#endif
+    if (eep.save(prgno, dst, plen, 1))  // 空き部分は再利用されるため書込み完了を待つ
+      err = ERR_NOFSPACE;
+    if (err)
+      return;
+  }
+  putnum(len - plen, 0);
+  c_puts_P((const char*)F(" bytes saved"));
+  newline();
+}
+#endif
+
+#if USE_ADATA == 1
+// 配列・変数の保存/読込み
+// ASAVE|ALOAD 配列開始番号,個数[,保存番号|"ファイル名"]
+// ASAVE|ALOAD VAR[,保存番号|"ファイル名"]
+//  ※保存番号省略時は最後の保存番号とする
+//    データは先頭に識別子と種別を付けて保存し、内部EEPROMへの保存は書込み完了を待つ
+//    読込み時は種別と保存データ長を確認し、不一致の場合はエラーとする
+// 引数
+//  mode     0:読込み、0以外:保存
+//
+void iAData(uint8_t mode) {
+  int16_t  top, num;
+  int16_t  prgno = EEPROM_SAVE_NUM-1;
+  uint8_t  head[ADATA_HEAD] = { ADATA_SIGN, ADATA_ARRAY };
+  uint8_t  chk[ADATA_HEAD];
+  uint8_t* ptr;
+  uint16_t len;
+  uint8_t  rc;
+
+  // 対象の取得
+  if (*cip == I_MVAR) {
+    cip++;
+    head[1] = ADATA_VAR;
+    ptr = (uint8_t*)var;
+    len = sizeof(var);
+  } else {
+    if ( getParam(top, 0, SIZE_ARRY-1, true) ||
+         getParam(num, 1, SIZE_ARRY-top, false) )
+      return;
+    ptr = (uint8_t*)&arr[top];
+    len = num * sizeof(arr[0]);
+  }
+
+  // 保存先の取得
+  if (*cip == I_COMMA) {
+    cip++;
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+    if (*cip == I_STR) {
+      // 外部接続I2C EEPROM
+      uint8_t fname[TI2CEEPROM_FNAMESIZ+1];
+      if (getFname(fname, TI2CEEPROM_FNAMESIZ))
+        return;
+      if (!*fname) {
+        err = ERR_FNAME;
+        return;
+      }
+      if (mode) {
+ #if USE_DATAFILE == 1
+        closeData(fname);  // オープン中のデータファイルの場合はクローズ
+        if (err) return;
+ #endif
+        rc = rom.save(fname, ptr, len, TI2CEEPROM_F_DATA, head, ADATA_HEAD);
+      } else if ( !(rc = rom.load(fname, 0, chk, ADATA_HEAD)) ) {
+        if (memcmp(chk, head, ADATA_HEAD) || rom.fileSize(fname) != ADATA_HEAD + len)
+          rc = 3;          // 種別、データ長の不一致
+        else
+          rc = rom.load(fname, ADATA_HEAD, ptr, len);
+      }
+      if (rc == 2)
+        err = mode ? ERR_NOFSPACE : ERR_FNAME;
+      else if (rc == 3)
+        err = ERR_VALUE;
+      else if (rc)
+        err = ERR_I2CDEV;
+      return;
+    }
+#endif
+    if ( getParam(prgno, 0, EEPROM_SAVE_NUM-1, false) )
+      return;
+  }
+
+  // 内部EEPROM
+  if (mode) {
+    if (eep.save(prgno, ptr, len, 1, head, ADATA_HEAD))
+      err = ERR_NOFSPACE;
+  } else if ( (rc = eep.check(prgno)) ) {
+    err = (rc == 2) ? ERR_VALUE : ERR_CHKSUM;  // データなし、保存データ破損
+  } else {
+    eep.read(prgno, 0, chk, ADATA_HEAD);
+    if (memcmp(chk, head, ADATA_HEAD) || eep.size(prgno) != ADATA_HEAD + len)
+      err = ERR_VALUE;                         // 種別、データ長の不一致
+    else
+      eep.read(prgno, ADATA_HEAD, ptr, len);
+  }
+}
+#endif
+
+#if USE_SNAPSHOT != 0
+// 実行状態の保存データ(SNAPSHOT)
+// (プログラム領域内のポインタはプログラム領域先頭からの位置とする)
+typedef struct {
+  uint8_t  sign[ADATA_HEAD];   // 識別子+種別(ADATA_SNAP)
+  uint8_t  ntok;               // 中間コード数(I_EOL、中間コードの構成の整合確認用)
+  uint16_t base;               // プログラム領域のアドレス(文字列定数のアドレスの整合確認用)
+  uint16_t narr;               // 配列数
+  uint16_t plen;               // プログラム長(終端を含む)
+  uint16_t clp, cip;           // 実行位置
+  uint8_t  gstki, lstki;       // スタックインデックス
+  uint16_t gstk[SIZE_GSTK];    // GOSUBスタック
+  uint16_t lstk[SIZE_LSTK];    // FORスタック
+  uint8_t  val_if;             // IF文判定結果
+ #if USE_EVENT == 1
+  evtsnap_t evt;               // イベント設定
+ #endif
+} snap_t;
+
+#define SNAP_SIZE(s)  (sizeof(snap_t) + sizeof(var) + sizeof(arr) + (s).plen)  // 保存データ長
+#define LSTK_PTRNUM   2        // FORスタックの1段(5要素)の先頭のポインタ数(行、中間コード)
+
+uint8_t flgResume = 0;         // RESUMEによる再開フラグ
+
+// プログラム領域内のポインタの位置への変換
+// 引数
+//  p   : ポインタ
+//  pos : 位置の格納先
+// 戻り値
+//  0:正常 1:プログラム領域外
+static uint8_t ptr2pos(uint8_t* p, uint16_t& pos) {
+  if (p < listbuf || p >= listbuf + SIZE_LIST)
+    return 1;
+  pos = p - listbuf;
+  return 0;
+}
+
+// SNAPSHOT、RESUMEのファイル名の長さ(I2C EEPROMを利用しない場合は内部EEPROMのみのため0)
+ #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+  #define SNAP_FNAMESIZ TI2CEEPROM_FNAMESIZ
+ #else
+  #define SNAP_FNAMESIZ 0
+ #endif
+
+// SNAPSHOT、RESUMEの保存先の取得
+// [保存番号|"ファイル名"]
+// 引数
+//  prgno : 保存番号の格納先(省略時は最後の保存番号)
+//  fname : ファイル名の格納先(内部EEPROMの場合は空文字列)
+// 戻り値
+//  0:正常 1:エラー
+static uint8_t getSnapTarget(int16_t& prgno, uint8_t* fname) {
+  prgno = EEPROM_SAVE_NUM-1;
+  *fname = 0;
+  if (*cip == I_EOL || *cip == I_COLON)
+    return 0;
+ #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+  if (*cip == I_STR) {
+    if (getFname(fname, TI2CEEPROM_FNAMESIZ))
+      return 1;
+    if (!*fname) {
+      err = ERR_FNAME;
+      return 1;
+    }
+    return 0;
+  }
+ #endif
+  return getParam(prgno, 0, EEPROM_SAVE_NUM-1, false);
+}
+
+// 実行状態の保存
+// SNAPSHOT [保存番号|"ファイル名"]
+//  ※変数、配列、プログラム、GOSUB・FORのスタック、実行位置、イベント設定を保存する
+//    RESUMEで再開すると、SNAPSHOTの次の文から実行を続ける
+//    プログラム中でのみ利用可能、内部EEPROMへの保存は書込み完了を待つ
+//    (実行位置、スタック、イベントの飛び先が他のバンクを指す場合はエラー)
+//    I2C EEPROMのファイルには、末尾にCRC16を付けて保存する
+void isnapshot() {
+  snap_t  s;
+  int16_t prgno;
+  uint8_t fname[SNAP_FNAMESIZ+1];
+
+  if (getSnapTarget(prgno, fname))
+    return;
+
+  // 実行状態の取得
+  memset(&s, 0, sizeof(snap_t));
+  s.sign[0] = ADATA_SIGN;
+  s.sign[1] = ADATA_SNAP;
+  s.ntok    = I_EOL;
+  s.base    = (uint16_t)listbuf;
+  s.narr    = SIZE_ARRY;
+  s.plen    = SIZE_LIST - getsize();
+  s.gstki   = gstki;
+  s.lstki   = lstki;
+  s.val_if  = val_if;
+  if (ptr2pos(clp, s.clp) || ptr2pos(cip, s.cip)) {
+    err = ERR_COM;  // プログラム中以外(コマンドライン、他のバンク)
+    return;
+  }
+  for (uint8_t i = 0; i < gstki; i++) {
+    if (ptr2pos(gstk[i], s.gstk[i])) {
+      err = ERR_COM;
+      return;
+    }
+  }
+  for (uint8_t i = 0; i < lstki; i++) {
+    if (i % 5 >= LSTK_PTRNUM)
+      s.lstk[i] = (uint16_t)(uintptr_t)lstk[i];  // 終了値、増分、変数番号
+    else if (ptr2pos(lstk[i], s.lstk[i])) {
+      err = ERR_COM;
+      return;
+    }
+  }
+ #if USE_EVENT == 1
+  if (evtSave(&s.evt)) {
+    err = ERR_COM;  // イベントの飛び先が他のバンク
+    return;
+  }
+ #endif
+
+  // 保存
+  waitSave();
+ #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+  if (*fname) {
+    ti2ceeprom_file_t f;
+    uint16_t crc = 0xffff;
+    uint8_t  rc, rc2;
+    for (uint16_t i = 0; i < sizeof(snap_t); i++)
+      crc = _crc16_update(crc, ((uint8_t*)&s)[i]);
+    for (uint16_t i = 0; i < sizeof(var); i++)
+      crc = _crc16_update(crc, ((uint8_t*)var)[i]);
+    for (uint16_t i = 0; i < sizeof(arr); i++)
+      crc = _crc16_update(crc, ((uint8_t*)arr)[i]);
+    for (uint16_t i = 0; i < s.plen; i++)
+      crc = _crc16_update(crc, listbuf[i]);
+  #if USE_DATAFILE == 1
+    closeData(fname);  // オープン中のデータファイルの場合はクローズ
+    if (err) return;
+  #endif
+    // 実行状態を保存したファイルに、変数、配列、プログラム、CRCを追記する
+    if ( !(rc = rom.save(fname, (uint8_t*)&s, sizeof(snap_t))) &&
+         !(rc = rom.open(&f, fname, 1)) ) {
+      if ( !(rc = rom.append(&f, (uint8_t*)var, sizeof(var))) &&
+           !(rc = rom.append(&f, (uint8_t*)arr, sizeof(arr))) &&
+           !(rc = rom.append(&f, listbuf, s.plen)) )
+        rc = rom.append(&f, (uint8_t*)&crc, sizeof(crc));
+      rc2 = rom.close(&f);
+      if (!rc)
+        rc = rc2;
+    }
+    if (rc == 2 || rc == 3)
+      err = ERR_NOFSPACE;
+    else if (rc)
+      err = ERR_I2CDEV;
+  } else
+ #endif
+  {
+    teeprom_seg_t seg[4] = {
+      { (uint8_t*)&s, sizeof(snap_t) }, { (uint8_t*)var, sizeof(var) },
+      { (uint8_t*)arr, sizeof(arr) },   { listbuf, s.plen } };
+    if (eep.save(prgno, seg, 4))
+      err = ERR_NOFSPACE;
+  }
+  flgResume = 0;
+}
+
+// 保存データの実行状態の確認
+// 戻り値
+//  0:正常 1:異常(保存時とプログラム領域、配列の構成が異なる)
+static uint8_t checkSnap(snap_t& s) {
+  if (s.sign[0] != ADATA_SIGN || s.sign[1] != ADATA_SNAP || s.ntok != I_EOL ||
+      s.base != (uint16_t)listbuf || s.narr != SIZE_ARRY ||
+      !s.plen || s.plen > SIZE_LIST || s.clp >= s.plen || s.cip >= s.plen ||
+      s.gstki > SIZE_GSTK || s.lstki > SIZE_LSTK)
+    return 1;
+  return 0;
+}
+
+// 実行状態の復元
+// (保存データは読込み済みであること)
+static void restoreSnap(snap_t& s) {
+  clp = listbuf + s.clp;
+  cip = listbuf + s.cip;
+  gstki = s.gstki;
+  lstki = s.lstki;
+  for (uint8_t i = 0; i < gstki; i++)
+    gstk[i] = listbuf + s.gstk[i];
+  for (uint8_t i = 0; i < lstki; i++)
+    lstk[i] = (i % 5 >= LSTK_PTRNUM) ? (uint8_t*)(uintptr_t)s.lstk[i] : listbuf + s.lstk[i];
+  val_if = s.val_if;
+ #if USE_EVENT == 1
+  evtRestore(&s.evt);
+ #endif
+  flgResume = 1;
+}
+
+// 内部EEPROMの保存データからの実行状態の復元
+// 引数
+//  prgno : 保存番号
+static void resumeEEP(uint8_t prgno) {
+  snap_t  s;
+  uint8_t rc;
+
+  if ( (rc = eep.check(prgno)) ) {
+    err = (rc == 2) ? ERR_VALUE : ERR_CHKSUM;  // データなし、保存データ破損
+    return;
+  }
+  eep.read(prgno, 0, (uint8_t*)&s, sizeof(snap_t));
+  if (checkSnap(s) || eep.size(prgno) != SNAP_SIZE(s)) {
+    err = ERR_VALUE;                           // スナップショット以外、構成の不一致
+    return;
+  }
+  eep.read(prgno, sizeof(snap_t), (uint8_t*)var, sizeof(var));
+  eep.read(prgno, sizeof(snap_t) + sizeof(var), (uint8_t*)arr, sizeof(arr));
+  eep.read(prgno, sizeof(snap_t) + sizeof(var) + sizeof(arr), listbuf, s.plen);
+  restoreSnap(s);
+}
+
+ #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+// I2C EEPROMの保存データからの実行状態の復元
+// (CRCを確認してから読み込む)
+// 引数
+//  fname : ファイル名
+static void resumeROM(uint8_t* fname) {
+  snap_t   s;
+  uint16_t len, crc = 0xffff, chk;
+  uint8_t  n, rc;
+
+  if ( (rc = rom.load(fname, 0, (uint8_t*)&s, sizeof(snap_t))) ) {
+    err = (rc == 2) ? ERR_FNAME : ERR_I2CDEV;
+    return;
+  }
+  if (checkSnap(s) || rom.fileSize(fname) != SNAP_SIZE(s) + sizeof(crc)) {
+    err = ERR_VALUE;
+    return;
+  }
+  len = SNAP_SIZE(s);
+  for (uint16_t pos = 0; pos < len; pos += n) {
+    n = (len - pos > SIZE_LINE) ? SIZE_LINE : len - pos;
+    if (rom.load(fname, pos, lbuf, n)) {
+      err = ERR_I2CDEV;
+      return;
+    }
+    for (uint8_t i = 0; i < n; i++)
+      crc = _crc16_update(crc, lbuf[i]);
+  }
+  if (rom.load(fname, len, (uint8_t*)&chk, sizeof(chk))) {
+    err = ERR_I2CDEV;
+    return;
+  }
+  if (crc != chk) {
+    err = ERR_CHKSUM;
+    return;
+  }
+  if (rom.load(fname, sizeof(snap_t), (uint8_t*)var, sizeof(var)) ||
+      rom.load(fname, sizeof(snap_t) + sizeof(var), (uint8_t*)arr, sizeof(arr)) ||
+      rom.load(fname, sizeof(snap_t) + sizeof(var) + sizeof(arr), listbuf, s.plen)) {
+    *listbuf = 0;
+    err = ERR_I2CDEV;
+    return;
+  }
+  restoreSnap(s);
+}
+ #endif
+
+// 実行状態の復元
+// RESUME [保存番号|"ファイル名"]
+//  ※SNAPSHOTで保存した実行状態を復元し、SNAPSHOTの次の文から実行を再開する
+//    (保存時とプログラム領域のアドレス、配列数が異なる場合はエラー)
+void iresume() {
+  int16_t prgno;
+  uint8_t fname[SNAP_FNAMESIZ+1];
+
+  if (getSnapTarget(prgno, fname))
+    return;
+  waitSave();
+ #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+  if (*fname)
+    resumeROM(fname);
+  else
+ #endif
+  resumeEEP(prgno);
+}
+
+// RESUMEによる再開の判定
+// RESUME()
+// 戻り値
+//  1:RESUMEで再開後(次のSNAPSHOT、RUNまで) 0:それ以外
+int16_t iresumestat() {
+  if (checkOpen()||checkClose()) return 0;
+  return flgResume;
+}
+
+ #if USE_SNAPSHOT == 2
+// 自動起動時のスナップショットからの再開
+// (内部EEPROMの最後の保存番号にスナップショットがある場合に、実行状態を復元する)
+// 戻り値
+//  1:復元した 0:スナップショットなし、または復元できない(通常の自動起動を行う)
+uint8_t autoResume() {
+  uint8_t head[ADATA_HEAD];
+  if (eep.read(EEPROM_SAVE_NUM-1, 0, head, ADATA_HEAD) ||
+      head[0] != ADATA_SIGN || head[1] != ADATA_SNAP)
+    return 0;
+  resumeEEP(EEPROM_SAVE_NUM-1);
+  if (err) {
+    err = 0;
+    return 0;
+  }
+  return 1;
+}
+ #endif
+#endif
+
 void iefiles();
 void iedel();
 
 // EEPROM上のプログラム消去
-// ERASE[プログラム番号[,プログラム番号]|"ファイル名"
+// ERASE[プログラム番号[,プログラム番号] [WIPE]|"ファイル名"
+//  ※内部EEPROMはディレクトリの無効化のみ行う
+//    WIPE指定時は、未使用領域(過去の保存データを含む)の内容も消去する
 void ierase() {
   int16_t  s_prgno, e_prgno;
-  uint32_t* topAddr;
+  uint8_t  flgWipe = 0;
   
   // ファイル名指定の場合、I2C EPPROMの指定ファイル削除を行う
   if (*cip == I_STR) {
@@ -119,12 +931,15 @@ void ierase() {
     cip++;
     if ( getParam(e_prgno, 0, EEPROM_SAVE_NUM-1, false) ) return;
   }
+#if USE_ERASEWIPE == 1
+  if ( (flgWipe = (*cip == I_WIPE)) )
+    cip++;
+#endif
   for (uint8_t prgno = s_prgno; prgno <= e_prgno; prgno++) {
-    topAddr = (uint32_t*)(EEPROM_PAGE_SIZE*prgno);
-    for (uint16_t i=0; i < SIZE_LIST/4; i++) {
-      eeprom_update_dword(topAddr,0);
-    }      
+    eep.del(prgno);
   }
+  if (flgWipe)
+    eep.wipe();
 }
 
 // プログラムファイル一覧表示 FILES
@@ -134,6 +949,14 @@ void ifiles() {
      iefiles();
      return;
   } 
+#if USE_ROMPRG == 1
+  // ROM指定の場合、ROMプログラムの一覧表示を行う
+  if (*cip == I_ROM) {
+     cip++;
+     ifilesROM();
+     return;
+  }
+#endif
   
   int16_t StartNo, endNo; // プログラム番号開始、終了
   
@@ -158,11 +981,25 @@ void ifiles() {
   for (uint8_t i=StartNo ; i <= endNo; i++) {
     // EEOROMからデータのコピー
     clearlbuf();
-    eeprom_read_block(lbuf,(uint8_t*)(EEPROM_PAGE_SIZE*i), SIZE_LINE);
     putnum(i,1);  c_putch(':');
-    if( (lbuf[0] == 0x00) && (lbuf[1] == 0x00) ) {  //  プログラム有無のチェック
+    if ( eep.read(i, 0, lbuf, SIZE_LINE) ) {        //  プログラム有無のチェック
       c_puts_P((const char*)F("(none)"));        
+    } else if (*lbuf == ADATA_SIGN) {
+      if (lbuf[1] == ADATA_SNAP)
+        c_puts_P((const char*)F("(snapshot)"));
+      else
+        c_puts_P(lbuf[1] == ADATA_VAR ? (const char*)F("(var)") : (const char*)F("(array)"));
     } else {
+#if USE_PRGCOMP == 1
+      uint16_t olen;
+      if ( (olen = TLZSS::size(lbuf)) ) {
+        // 圧縮データの場合は先頭部分のみ伸長する
+        TLZSS lz;
+        lzPrgno = i;
+        if (lz.decode(lzReadEEP, lbuf, olen < SIZE_LINE ? olen : SIZE_LINE))
+          *lbuf = 0;
+      }
+#endif
       if (*lbuf) {
         putlist(lbuf+3);         // 行番号より後ろを文字列に変換して表示
       } 
@@ -200,93 +1037,66 @@ uint8_t getFname(uint8_t* fname, uint8_t limit) {
 #endif
 
 // EEPROMのフォーマット
-// FORMAT デバイスサイズ[,ドライブ名]
+// FORMAT デバイスサイズ[,ドライブ名][,ブロック選択ビット位置]
+//  デバイスサイズ : 4,8,16,32,64,128,256 (kバイト)
+//  ブロック選択ビット位置 : 64kバイトを超える場合の上位アドレスのスレーブアドレス上の位置
+//                           (省略時 128:2(24LC1025) 256:0(AT24CM02))
 void iformat() {
 #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
   uint8_t  devname[11];
   uint8_t  rc;
   int16_t  devsize;       // デバイスサイズ
+  int16_t  asel;          // ブロック選択ビット位置
   uint16_t fnum;          // ファイル数
   devname[0] = 0;
 
   // デバイス容量指定の取得
-#if PRGAREASIZE <= 512
-  if ( getParam(devsize, 4, 64, false) ) return;  
-  if (devsize == 4) {
-    fnum = 7;
-  } else if (devsize == 8) {
-    fnum = 15;
-  } else if (devsize == 16) {
-    fnum = 31;
-  } else if (devsize == 32) {
-    fnum = 62;
-  } else if (devsize == 64) {
-    fnum = 124;
-  } else {
+  if ( getParam(devsize, 4, 256, false) ) return;
+  if (devsize & (devsize-1)) {
     err = ERR_VALUE;
     return;
   }
-#elif PRGAREASIZE <= 1024
-  if ( getParam(devsize, 4, 64, false) ) return;  
-  if (devsize == 4) {
-    fnum = 3;
-  } else if (devsize == 8) {
-    fnum = 7;
-  } else if (devsize == 16) {
-    fnum = 25;
-  } else if (devsize == 32) {
-    fnum = 31;
-  } else if (devsize == 64) {
-    fnum = 63;
-  } else {
-    err = ERR_VALUE;
-    return;
-  }
-#elif PRGAREASIZE <= 2048
-  if ( getParam(devsize, 4, 64, false) ) return;  
-  if (devsize == 4) {
-    fnum = 1;
-  } else if (devsize == 8) {
-    fnum = 3;
-  } else if (devsize == 16) {
-    fnum = 7;
-  } else if (devsize == 32) {
-    fnum = 15;
-  } else if (devsize == 64) {
-    fnum = 31;
-  } else {
-    err = ERR_VALUE;
-    return;
-  }
-#elif PRGAREASIZE <= 4096
-  if ( getParam(devsize, 4, 64, false) ) return;  
- if (devsize == 8) {
-    fnum = 1;
-  } else if (devsize == 16) {
-    fnum = 3;
-  } else if (devsize == 32) {
-    fnum = 7;
-  } else if (devsize == 64) {
-    fnum = 15;
-  } else {
-    err = ERR_VALUE;
-    return;
+  fnum = (devsize >= 32) ? 128 : devsize*4;  // ファイル数(ファイルは可変長のため容量に比例)
+  asel = (devsize == 128) ? 2 : 0;
+
+  // ファイル名、ブロック選択ビット位置の取得
+  if (*cip == I_COMMA) {
+    cip++;
+    if (*cip == I_STR) {
+      if (getFname(devname, 10))  return;
+      if (*cip == I_COMMA) {
+        cip++;
+        if ( getParam(asel, 0, 6, false) ) return;
+      }
+    } else {
+      if ( getParam(asel, 0, 6, false) ) return;
+    }
   }
-#endif
-    // ファイル名の取得
-   if (*cip == I_COMMA) {
-     cip++;
-    if (getFname(devname, 10))  return;  
-   }
-   
+
   // デバイスのフォーマット
-  rc = rom.format((uint8_t*)MYSIGN, devname, fnum, SIZE_LIST);
+#if USE_DATAFILE == 1
+  dfile.index = TI2CEEPROM_FCLOSED;  // オープン中のデータファイルは破棄する
+#endif
+  rc = rom.format((uint8_t*)MYSIGN, devname, fnum, devsize, asel);
   if (rc) {
-    err = ERR_I2CDEV; // I2Cデバイスエラー    
+    err = ERR_I2CDEV; // I2Cデバイスエラー
   }
 #endif
 }
 
+// I2C EEPROMの詰め直し
+// COMPACT
+void icompact() {
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
+ #if USE_DATAFILE == 1
+  closeData(NULL);    // ブロックが移動するため、データファイルはクローズする
+  if (err) return;
+ #endif
+  if (rom.compact())
+    err = ERR_I2CDEV; // I2Cデバイスエラー
+#endif
+}
+
 #if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1
 // ワイルドカードでのマッチング(下記のリンク先のソースを利用)
 // http://qiita.com/gyu-don/items/5a640c6d2252a860c8cd
@@ -397,6 +1207,10 @@ void iedel() {
     if (getFname(fname, TI2CEEPROM_FNAMESIZ)) 
       return;
   
+#if USE_DATAFILE == 1
+    closeData(fname);  // オープン中のデータファイルの場合はクローズ
+    if (err) return;
+#endif
     // プログラムのロード
     if ( (rc = rom.del(fname)) ) {
       if (rc == 2)
@@ -425,6 +1239,133 @@ void idrive() {
   } else {
     if ( getParam(adr, 1,0x7f, false) ) return;
   }  
+#if USE_DATAFILE == 1
+  closeData(NULL);    // 変更前のデバイスのデータファイルはクローズする
+  if (err) return;
+#endif
   rom.setSlaveAddr(adr); 
 #endif  
 }
+
+// データファイルのオープン
+// OPEN "ファイル名" [FOR APPEND]
+//  ※同時にオープン出来るファイルは1つ(オープン中のファイルはクローズする)
+//    FOR APPEND指定時は追記可能とし、ファイルがない場合は新規に作成する
+//    (データファイル以外のファイルへのFOR APPEND指定はエラー)
+void iopen() {
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 && USE_DATAFILE == 1
+  uint8_t fname[TI2CEEPROM_FNAMESIZ+1];
+  uint8_t flgAppend = 0;
+
+  if (getFname(fname, TI2CEEPROM_FNAMESIZ))
+    return;
+  if (!*fname) {
+    err = ERR_FNAME;
+    return;
+  }
+  if (*cip == I_FOR) {
+    cip++;
+    if (*cip != I_APPEND) {
+      err = ERR_SYNTAX;
+      return;
+    }
+    cip++;
+    flgAppend = 1;
+  }
+  closeData(NULL);
+  if (!err)
+    dataErr(rom.open(&dfile, fname, flgAppend));
+#endif
+}
+
+// データファイルへの追記
+// WRITE# 仮想アドレス,バイト数
+//  ※書込みバッファに蓄積し、書込み単位に達した時点でEEPROMに書き込む
+void iwrite() {
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 && USE_DATAFILE == 1
+  int16_t  top, len;
+  uint8_t* ptr;
+
+  if ( getParam(top, 0, 32767, true) ||
+       getParam(len, 0, 32767, false) )
+    return;
+  ptr = v2realAddr(top);
+  if (!ptr || (len && !v2realAddr(top+len-1))) {
+    err = ERR_VALUE;
+    return;
+  }
+  if (dfile.index == TI2CEEPROM_FCLOSED || !dfile.mode) {
+    err = ERR_FNOPEN;
+    return;
+  }
+  if (dfile.len + dfile.n + len > 0xFFFF) {
+    err = ERR_NOFSPACE;  // ファイル長はLOF()で参照可能な範囲まで
+    return;
+  }
+  dataErr(rom.append(&dfile, ptr, len));
+#endif
+}
+
+// データファイルの読込み
+// READ# 仮想アドレス,バイト数,ファイル内位置
+//  ※ファイル内位置の負の値は32768以上として扱う
+void iread() {
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 && USE_DATAFILE == 1
+  int16_t  top, len, pos;
+  uint8_t* ptr;
+  uint8_t  rc;
+
+  if ( getParam(top, 0, 32767, true) ||
+       getParam(len, 0, 32767, true) ||
+       getParam(pos, false) )
+    return;
+  ptr = v2realAddr(top);
+  if (!ptr || (len && !v2realAddr(top+len-1))) {
+    err = ERR_VALUE;
+    return;
+  }
+  if (dfile.index == TI2CEEPROM_FCLOSED) {
+    err = ERR_FNOPEN;
+    return;
+  }
+  if (ptr >= listbuf && ptr < listbuf + SIZE_LIST)
+    waitSave();   // プログラム領域への書込みは保存完了を待つ
+  if ( (rc = rom.readData(&dfile, (uint16_t)pos, ptr, len)) == 2 )
+    err = ERR_VALUE;  // ファイル長を超える
+  else
+    dataErr(rc);
+#endif
+}
+
+// データファイルの書込みバッファの書込み
+// FLUSH
+void iflush() {
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 && USE_DATAFILE == 1
+  if (dfile.index != TI2CEEPROM_FCLOSED)
+    dataErr(rom.flush(&dfile));
+#endif
+}
+
+// データファイルのクローズ
+// CLOSE
+void iclose() {
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 && USE_DATAFILE == 1
+  closeData(NULL);
+#endif
+}
+
+// データファイルのファイル長(書込みバッファ内のデータを含む)
+// LOF()
+//  ※32768以上は負の値となる
+int16_t ilof() {
+  if (checkOpen()||checkClose()) return 0;
+#if USE_I2CEEPROM == 1 && USE_CMD_I2C == 1 && USE_DATAFILE == 1
+  if (dfile.index == TI2CEEPROM_FCLOSED) {
+    err = ERR_FNOPEN;
+    return 0;
+  }
+  return dfile.len + dfile.n;
+#else
+  return 0;
+#endif
+}
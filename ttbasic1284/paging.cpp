@@ -0,0 +1,618 @@
+//
+// Arduino Uno互換機+「アクティブマトリクス蛍光表示管（CL-VFD）MW25616L 実験用表示モジュール」対応
+// I2C EEPROMのプログラムのページ実行（プログラム領域を超えるプログラムの実行）
+// 作成 2026/10/19
+// 修正 2026/10/19 フラッシュメモリ上のプログラム(ROMプログラム)の実行対応(USE_ROMPRG)
+// 修正 2026/10/19 ラベルの飛び先の検索をキャッシュ、ラベルインデックスから行うように変更
+// 修正 2026/10/19 行末の中間コードの確認による異なる版で保存したプログラムの検出
+//
+// [仕様]
+// ・I2C EEPROMに保存したプログラムファイルを、プログラム領域に読み込まずに実行する
+//   (SAVE "ファイル名" APPENDで、プログラム領域を超えるプログラムを分割して作成可能)
+// ・実行中はプログラム領域を行キャッシュとして利用し、行単位に読み込む
+//   キャッシュが一杯の場合は、最も長く参照されていない行(LRU)を追い出す
+//   (実行中の行、GOSUB・FORのスタック、イベントの飛び先の行は追い出さない)
+// ・GOTO等の飛び先の検索用に、一定行数間隔の行インデックス(行番号、ファイル内位置)と
+//   ラベルインデックス(ラベル名のハッシュ値、ファイル内位置)を実行開始時に作成する
+//   (ラベル数がPG_LBLNUMを超える場合、インデックスにないラベルはファイルの先頭から検索する)
+// ・ファイル内の行長0のバイトは区切り(追記前の終端)として読み飛ばし、ファイル末尾で終了する
+// ・実行終了後、プログラム領域は空となる
+//   また、実行中はプログラム領域の編集等(LIST,NEW,RENUM,DELETE,LOAD,SAVE,CHAIN)は利用できない
+// ・文字列定数のアドレス(変数への代入)は、その行がキャッシュ上にある間のみ有効
+// ・ROMプログラム(romprg.hで定義したフラッシュメモリ上のプログラム)も同じ方法で実行する
+//   (RUN ROM 番号|"名前")
+//   行の読込みはフラッシュメモリからの複写のみのため、I2C EEPROMより高速に実行できる
+//   ※中間コードの参照は全てSRAM上のポインタで行うため、フラッシュメモリ上で直接は実行しない
+//
+// ・プログラム領域(キャッシュ)のデータ構造
+//   終端(0) + ファイル情報 + ROMプログラムのアドレス + 行インデックス x PG_IDXNUM
+//   + ラベルインデックス x PG_LBLNUM + スロット管理情報 + スロット(1行+終端) x PG_SLOTNUM
+//
+
+#include "Arduino.h"
+#include "basic.h"
+
+#if USE_PAGEDRUN == 1
+#include "src/lib/TI2CEEPROM.h"
+extern TI2CEEPROM rom;
+
+#define PG_IDXNUM    (SIZE_LIST/32)  // 行インデックス数
+#define PG_LBLNUM    (SIZE_LIST/64)  // ラベルインデックス数
+#define PG_SLOTSIZE  (SIZE_IBUF+1)   // スロットサイズ(1行+終端)
+#define PG_SLOTNUM   ((SIZE_LIST-sizeof(ti2ceeprom_file_t)-sizeof(uint8_t*)-9-PG_IDXNUM*4-PG_LBLNUM*4)/(PG_SLOTSIZE+4)) // スロット数
+#define PG_EMPTY     0xFFFF          // 未使用スロット
+#define PG_HEAD      3               // 行の先頭部(行長+行番号)のサイズ
+
+// 行インデックス
+typedef struct {
+  int16_t  no;   // 行番号
+  uint16_t pos;  // ファイル内位置
+} pgidx_t;
+
+// ラベルインデックス
+typedef struct {
+  uint16_t hash; // ラベル名のハッシュ値
+  uint16_t pos;  // ファイル内位置
+} pglbl_t;
+
+// 行キャッシュ(プログラム領域に配置)
+typedef struct {
+  uint8_t  eop;                              // プログラム終端(プログラム領域は空として扱う)
+  ti2ceeprom_file_t f;                       // 実行中のプログラムファイル
+  const uint8_t* flash;                      // ROMプログラムのアドレス(NULL:I2C EEPROMのファイル)
+  uint16_t tick;                             // 参照カウンタ(LRU判定用)
+  uint16_t step;                             // 行インデックスの登録間隔(行数)
+  uint16_t nidx;                             // 行インデックス登録数
+  pgidx_t  idx[PG_IDXNUM];                   // 行インデックス
+  uint16_t nlbl;                             // ラベルインデックス登録数(PG_LBLNUMを超える場合は全ラベル数)
+  pglbl_t  lbl[PG_LBLNUM];                   // ラベルインデックス
+  uint16_t pos[PG_SLOTNUM];                  // スロットの行のファイル内位置
+  uint16_t use[PG_SLOTNUM];                  // スロットの最終参照時の参照カウンタ
+  uint8_t  slot[PG_SLOTNUM][PG_SLOTSIZE];    // スロット
+} pgcache_t;
+
+#define pg ((pgcache_t*)listbuf)
+
+static uint8_t  pgActive = 0;     // ページ実行中フラグ
+static uint8_t  pgEnd = 0;        // 行なし(終端)
+static uint32_t pgHit, pgMiss;    // キャッシュのヒット数、ミス数
+
+#if USE_ROMPRG == 1
+// ROMプログラムの登録テーブル
+typedef struct {
+  char name[TI2CEEPROM_FNAMESIZ+1];  // 名前
+  const uint8_t* prg;                // プログラム
+  uint16_t len;                      // プログラム長
+} romprg_t;
+
+#define ROMPRG(name, prg)  { name, prg, sizeof(prg) }
+#include "romprg.h"
+static const romprg_t romprg[] PROGMEM = { ROMPRG_TABLE };
+#define ROMPRG_NUM  (sizeof(romprg)/sizeof(romprg_t))  // 登録数
+#endif
+
+// ページ実行中の判定
+uint8_t isPaged() {
+  return pgActive;
+}
+
+// ページ実行中のプログラム領域の編集等のチェック
+// 戻り値
+//  0:実行中でない 1:実行中(エラー)
+uint8_t checkPaged() {
+  if (pgActive)
+    err = ERR_COM;
+  return pgActive;
+}
+
+// プログラムの読込み(I2C EEPROMのファイル、またはROMプログラム)
+// 引数
+//  pos : ファイル内位置
+//  buf : 格納アドレス
+//  len : 読込みバイト数
+// 戻り値
+//  0:正常 1:エラー(errにERR_I2CDEVを設定)
+static uint8_t pgRead(uint16_t pos, uint8_t* buf, uint8_t len) {
+#if USE_ROMPRG == 1
+  if (pg->flash) {
+    memcpy_P(buf, pg->flash + pos, len);
+    return 0;
+  }
+#endif
+  if (rom.readData(&pg->f, pos, buf, len)) {
+    err = ERR_I2CDEV;
+    return 1;
+  }
+  return 0;
+}
+
+// 行の先頭部の読込み
+// 行長0の区切りは読み飛ばす
+// 引数
+//  pos  : ファイル内位置(区切りを読み飛ばした位置に更新)
+//  head : 行の先頭部格納アドレス
+// 戻り値
+//  0:正常 1:ファイル末尾
+static uint8_t readHead(uint16_t& pos, uint8_t* head) {
+  for (;;) {
+    if ((uint32_t)pos + PG_HEAD > pg->f.len)
+      return 1;
+    if (pgRead(pos, head, PG_HEAD))
+      return 1;
+    if (*head)
+      return 0;
+    pos++;
+  }
+}
+
+// スロットの追い出し対象外判定
+// (実行中の行、GOSUB・FORのスタック、イベントの飛び先が参照している場合は対象外)
+static uint8_t isPinned(uint8_t* top) {
+  uint8_t* end = top + PG_SLOTSIZE;
+  if (clp >= top && clp < end)
+    return 1;
+  for (uint8_t i = 0; i < gstki; i++)
+    if (gstk[i] >= top && gstk[i] < end)
+      return 1;
+  for (uint8_t i = 0; i < lstki; i++)
+    if (lstk[i] >= top && lstk[i] < end)
+      return 1;
+#if USE_EVENT == 1
+  if (isEventLine(top, end))
+    return 1;
+#endif
+  return 0;
+}
+
+// キャッシュ上の行の参照
+// 引数
+//  pos : ファイル内位置
+// 戻り値
+//  スロットのアドレス(キャッシュにない場合はNULL)
+static uint8_t* findSlot(uint16_t pos) {
+  for (uint8_t i = 0; i < PG_SLOTNUM; i++) {
+    if (pg->pos[i] == pos) {
+      pg->use[i] = ++pg->tick;
+      pgHit++;
+      return pg->slot[i];
+    }
+  }
+  return NULL;
+}
+
+// 行のキャッシュへの読込み
+// 引数
+//  pos : ファイル内位置
+//  len : 行長
+// 戻り値
+//  スロットのアドレス(エラーの場合はNULL)
+static uint8_t* loadSlot(uint16_t pos, uint8_t len) {
+  uint8_t  n = PG_SLOTNUM;
+  uint16_t age = 0;
+
+  // 未使用、または最も長く参照されていないスロットを選ぶ
+  for (uint8_t i = 0; i < PG_SLOTNUM; i++) {
+    if (pg->pos[i] == PG_EMPTY) {
+      n = i;
+      break;
+    }
+    if ((uint16_t)(pg->tick - pg->use[i]) >= age && !isPinned(pg->slot[i])) {
+      age = pg->tick - pg->use[i];
+      n = i;
+    }
+  }
+  if (n == PG_SLOTNUM) {
+    err = ERR_LBUFOF;  // 全スロットが参照中
+    return NULL;
+  }
+  pgMiss++;
+  pg->pos[n] = PG_EMPTY;
+  if (pgRead(pos, pg->slot[n], len))
+    return NULL;
+  pg->slot[n][len] = 0;  // 終端(順次実行の判定、ENDで利用)
+  pg->pos[n] = pos;
+  pg->use[n] = ++pg->tick;
+  return pg->slot[n];
+}
+
+// 指定位置の行の取得
+// 引数
+//  pos : ファイル内位置(区切りの場合は次の行)
+// 戻り値
+//  行のアドレス(ファイル末尾、エラーの場合は終端のアドレス)
+static uint8_t* getLine(uint16_t pos) {
+  uint8_t  head[PG_HEAD];
+  uint8_t* lp;
+
+  if ( (lp = findSlot(pos)) )
+    return lp;
+  if (readHead(pos, head))
+    return &pgEnd;
+  if ( (lp = findSlot(pos)) || (lp = loadSlot(pos, *head)) )
+    return lp;
+  return &pgEnd;
+}
+
+// スロットの行のファイル内位置の取得
+static uint16_t slotPos(uint8_t* lp) {
+  return pg->pos[(lp - pg->slot[0]) / PG_SLOTSIZE];
+}
+
+// 指定行番号の行ポインタの取得(getlp()のページ実行版)
+// 引数
+//  lineno : 行番号
+// 戻り値
+//  行のアドレス(該当行がない場合は終端のアドレス)
+uint8_t* pgGetlp(int16_t lineno) {
+  uint8_t  head[PG_HEAD];
+  uint8_t* lp;
+  uint16_t pos;
+  int16_t  lo, hi, mid;
+
+  // キャッシュ上の行の検索
+  for (uint8_t i = 0; i < PG_SLOTNUM; i++) {
+    if (pg->pos[i] != PG_EMPTY && getlineno(pg->slot[i]) == lineno) {
+      pg->use[i] = ++pg->tick;
+      pgHit++;
+      return pg->slot[i];
+    }
+  }
+
+  // 行インデックスから検索開始位置を求める
+  if (!pg->nidx || lineno < pg->idx[0].no)
+    return &pgEnd;
+  lo = 0;
+  hi = pg->nidx - 1;
+  while (lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    if (pg->idx[mid].no <= lineno)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+
+  // 検索開始位置から行の先頭部を辿る
+  for (pos = pg->idx[lo].pos; !readHead(pos, head); pos += *head) {
+    int16_t no = head[1] | head[2] << 8;
+    if (no == lineno)
+      return (lp = loadSlot(pos, *head)) ? lp : &pgEnd;
+    if (no > lineno)
+      break;
+  }
+  return &pgEnd;
+}
+
+// ラベル名のハッシュ値
+// 引数
+//  name : ラベル名
+//  len  : 長さ
+static uint16_t labelHash(uint8_t* name, uint8_t len) {
+  uint16_t hash = 0;
+  while (len--)
+    hash = hash * 31 + *name++;
+  return hash;
+}
+
+// 行のラベルの判定
+// 引数
+//  lp     : 行のアドレス
+//  pLabel : [I_STR][長さ][ラベル名]
+// 戻り値
+//  1:一致 0:不一致
+static uint8_t isLabel(uint8_t* lp, uint8_t* pLabel) {
+  return *lp && lp[3] == I_STR && lp[4] == pLabel[1] && !strncmp((char*)lp+5, (char*)pLabel+2, pLabel[1]);
+}
+
+// 指定ラベルの行ポインタの取得(getlpByLabel()のページ実行版)
+// キャッシュ上の行、ラベルインデックスの順に検索し、該当する行のみ読み込む
+// (ラベル数がPG_LBLNUMを超えてインデックスにない場合は、ファイルの先頭から検索する)
+// 引数
+//  pLabel : [I_STR][長さ][ラベル名]
+// 戻り値
+//  行のアドレス(該当行がない場合はNULL)
+uint8_t* pgGetlpByLabel(uint8_t* pLabel) {
+  uint8_t  head[PG_HEAD+2];
+  uint8_t  name[SIZE_IBUF];
+  uint8_t  len = pLabel[1];
+  uint16_t hash = labelHash(pLabel+2, len);
+  uint16_t pos;
+  uint8_t* lp;
+
+  // キャッシュ上の行の検索
+  for (uint8_t i = 0; i < PG_SLOTNUM; i++) {
+    if (pg->pos[i] != PG_EMPTY && isLabel(pg->slot[i], pLabel)) {
+      pg->use[i] = ++pg->tick;
+      pgHit++;
+      return pg->slot[i];
+    }
+  }
+
+  // ラベルインデックスの検索
+  for (uint16_t i = 0; i < pg->nlbl && i < PG_LBLNUM; i++) {
+    if (pg->lbl[i].hash == hash) {
+      lp = getLine(pg->lbl[i].pos);
+      if (err)
+        return NULL;
+      if (isLabel(lp, pLabel))
+        return lp;
+    }
+  }
+  if (pg->nlbl <= PG_LBLNUM)
+    return NULL;
+
+  // ファイルの先頭からの検索
+  for (pos = 0; !readHead(pos, head); pos += *head) {
+    if (*head < PG_HEAD + 2 + len)
+      continue;
+    if (pgRead(pos + PG_HEAD, head + PG_HEAD, 2) ||
+        pgRead(pos + PG_HEAD + 2, name, len))
+      break;
+    if (head[3] == I_STR && head[4] == len && !strncmp((char*)name, (char*)pLabel+2, len))
+      return getLine(pos);
+  }
+  return NULL;
+}
+
+// 行インデックス、ラベルインデックスの作成
+// (行インデックスは登録数が一杯になったら1つおきに間引き、登録間隔を2倍にする)
+// 戻り値
+//  0:正常 1:エラー
+static uint8_t makeIndex() {
+  uint8_t  head[PG_HEAD+2];
+  uint8_t  name[SIZE_IBUF];
+  uint8_t  eol;
+  uint16_t pos;
+  uint16_t cnt = 0;
+  int16_t  prev = -1;
+
+  pg->nidx = 0;
+  pg->nlbl = 0;
+  pg->step = 1;
+  for (pos = 0; !readHead(pos, head); pos += *head, cnt++) {
+    int16_t no = head[1] | head[2] << 8;
+    if (*head < 4 || *head > SIZE_IBUF || (uint32_t)pos + *head > pg->f.len || no <= prev) {
+      err = ERR_VALUE;  // プログラムファイルの異常(行長、行番号の順序)
+      return 1;
+    }
+    if (pgRead(pos + *head - 1, &eol, 1))
+      return 1;
+    if (eol != I_EOL) {
+      err = ERR_VALUE;  // 中間コードの構成が異なる版で保存したプログラム
+      return 1;
+    }
+    prev = no;
+
+    // 行の先頭のラベルの登録
+    if (*head >= PG_HEAD + 3) {
+      if (pgRead(pos + PG_HEAD, head + PG_HEAD, 2))
+        return 1;
+      if (head[3] == I_STR && *head >= PG_HEAD + 3 + head[4]) {
+        if (pg->nlbl < PG_LBLNUM) {
+          if (pgRead(pos + PG_HEAD + 2, name, head[4]))
+            return 1;
+          pg->lbl[pg->nlbl].hash = labelHash(name, head[4]);
+          pg->lbl[pg->nlbl].pos  = pos;
+        }
+        pg->nlbl++;
+      }
+    }
+
+    if (cnt % pg->step)
+      continue;
+    if (pg->nidx == PG_IDXNUM) {
+      for (uint16_t i = 0; i < PG_IDXNUM/2; i++)
+        pg->idx[i] = pg->idx[i*2];
+      pg->nidx = PG_IDXNUM/2;
+      pg->step *= 2;
+      if (cnt % pg->step)
+        continue;
+    }
+    pg->idx[pg->nidx].no  = no;
+    pg->idx[pg->nidx].pos = pos;
+    pg->nidx++;
+  }
+  return err ? 1 : 0;
+}
+
+// 行キャッシュを初期化してページ実行する
+// (pg->f.len、pg->flashは設定済みであること)
+static void pgExec() {
+  uint8_t* lp;  // 行ポインタの一時的な記憶場所
+
+  pg->eop = 0;
+  pg->tick = 0;
+  for (uint8_t i = 0; i < PG_SLOTNUM; i++)
+    pg->pos[i] = PG_EMPTY;
+  pgHit = pgMiss = 0;
+  if (makeIndex())
+    return;
+
+  // 実行(irun()と同様、順次実行時の次の行はファイルから取得する)
+  initProgram();
+  pgActive = 1;
+  c_show_curs(0);
+  clp = getLine(0);
+  while (*clp) {
+    cip = clp + 3;
+    lp = iexe();
+    if (err)
+      break;
+    if (lp == clp + *clp && *clp)
+      lp = getLine(slotPos(clp) + *clp);  // 次の行
+    clp = lp;
+  }
+  c_show_curs(1);
+  pgActive = 0;
+#if USE_EVENT == 1
+  clerTimerEvent();
+  clerExtEvent();
+#endif
+}
+
+// プログラムファイルのページ実行
+// RUN "ファイル名"
+// 引数
+//  fname : ファイル名
+void pgRun(uint8_t* fname) {
+  ti2ceeprom_file_t f;
+
+  // プログラムファイルのオープン
+  waitSave();
+  switch (rom.open(&f, fname, 0)) {
+    case 0:  break;
+    case 2:  err = ERR_FNAME;  return;
+    default: err = ERR_I2CDEV; return;
+  }
+  if (f.len > 0xFFFF) {
+    err = ERR_LBUFOF;  // ファイル内位置が16ビットを超える
+    return;
+  }
+
+  // 以降、プログラム領域は行キャッシュとして利用する
+  pg->f = f;
+  pg->flash = NULL;
+  pgExec();
+  rom.close(&pg->f);  // プログラム領域は空となる(エラー表示用の行はスロット上に残る)
+}
+
+#if USE_ROMPRG == 1
+// ROMプログラムの指定の取得
+// 番号|"名前"
+// 引数
+//  e : 該当したROMプログラムの登録内容
+// 戻り値
+//  0:正常 1:エラー
+static uint8_t getROM(romprg_t& e) {
+  uint8_t fname[TI2CEEPROM_FNAMESIZ+1];
+  int16_t no;
+
+  if (*cip == I_STR) {
+    if (getFname(fname, TI2CEEPROM_FNAMESIZ))
+      return 1;
+    for (no = 0; no < (int16_t)ROMPRG_NUM; no++) {
+      memcpy_P(&e, &romprg[no], sizeof(romprg_t));
+      if (!strcmp((char*)fname, e.name))
+        return 0;
+    }
+    err = ERR_FNAME;
+    return 1;
+  }
+  if ( getParam(no, 0, ROMPRG_NUM-1, false) )
+    return 1;
+  memcpy_P(&e, &romprg[no], sizeof(romprg_t));
+  return 0;
+}
+
+// ROMプログラムの実行
+// RUN ROM 番号|"名前"
+void irunROM() {
+  romprg_t e;
+
+  if (getROM(e))
+    return;
+  waitSave();
+  pg->f.len = e.len;
+  pg->flash = e.prg;
+  pgExec();
+}
+
+// ROMプログラムのプログラム領域へのロード
+// LOAD ROM 番号|"名前"
+void iloadROM() {
+  romprg_t e;
+
+  if (getROM(e))
+    return;
+  if (e.len >= SIZE_LIST) {
+    err = ERR_LBUFOF;
+    return;
+  }
+  memcpy_P(listbuf, e.prg, e.len);
+  listbuf[e.len] = 0;
+  if (checkList(listbuf, SIZE_LIST)) {
+    *listbuf = 0;
+    err = ERR_VALUE;  // 中間コードの構成が異なる版で作成したプログラム
+  }
+}
+
+// ROMプログラムの一覧表示
+// FILES ROM
+void ifilesROM() {
+  romprg_t e;
+
+  for (uint8_t i = 0; i < ROMPRG_NUM; i++) {
+    memcpy_P(&e, &romprg[i], sizeof(romprg_t));
+    putnum(i, 1); c_putch(':');
+    c_puts(e.name);
+    c_putch(' ');
+    putnum(e.len, 0);
+    c_puts_P((const char*)F(" bytes"));
+    newline();
+  }
+}
+
+// プログラム領域のプログラムのROMプログラム定義形式(romprg.h)での出力
+// SAVE ROM "名前"
+void isaveROM() {
+  uint8_t  fname[TI2CEEPROM_FNAMESIZ+1];
+  uint8_t  vname[TI2CEEPROM_FNAMESIZ+1];  // 配列名に使う名前
+  uint8_t* lp;
+
+  if (getFname(fname, TI2CEEPROM_FNAMESIZ))
+    return;
+  if (!*fname || !*listbuf) {
+    err = ERR_VALUE;
+    return;
+  }
+  for (uint8_t i = 0; i <= TI2CEEPROM_FNAMESIZ; i++) {
+    vname[i] = fname[i];
+    if (fname[i] && !c_isalpha(fname[i]) && !c_isdigit(fname[i]))
+      vname[i] = '_';    // 変数名に使えない文字
+  }
+  c_puts_P((const char*)F("const uint8_t romprg_"));
+  c_puts((char*)vname);
+  c_puts_P((const char*)F("[] PROGMEM = {"));
+  newline();
+  for (lp = listbuf; *lp; lp += *lp) {
+    // 行のリスト(コメント)
+    c_puts_P((const char*)F("  // "));
+    putnum(getlineno(lp), 0);
+    c_putch(' ');
+    putlist(lp+3);
+    newline();
+    // 行の中間コード
+    c_puts_P((const char*)F("  "));
+    for (uint8_t i = 0; i < *lp; i++) {
+      putnum(lp[i], 0);
+      c_putch(',');
+    }
+    newline();
+    if (err)
+      return;
+  }
+  c_puts_P((const char*)F("};"));
+  newline();
+  c_puts_P((const char*)F("// ROMPRG(\""));
+  c_puts((char*)fname);
+  c_puts_P((const char*)F("\", romprg_"));
+  c_puts((char*)vname);
+  c_puts_P((const char*)F("),"));
+  newline();
+}
+#endif
+
+// 行キャッシュの統計情報の表示(SYSINFO)
+void pgInfo() {
+  c_puts_P((const char*)F("\nPage cache:"));
+  putnum(PG_SLOTNUM, 0);
+  c_puts_P((const char*)F(" lines hit:"));
+  putnum(pgHit > 32767 ? 32767 : pgHit, 0);
+  c_puts_P((const char*)F(" miss:"));
+  putnum(pgMiss > 32767 ? 32767 : pgMiss, 0);
+  if (pgHit + pgMiss) {
+    c_puts_P((const char*)F(" ("));
+    putnum(pgHit * 100 / (pgHit + pgMiss), 0);
+    c_puts_P((const char*)F("%)"));
+  }
+}
+#endif
@@ -0,0 +1,31 @@
+//
+// Arduino Uno互換機+「アクティブマトリクス蛍光表示管（CL-VFD）MW25616L 実験用表示モジュール」対応
+// ROMプログラム定義（フラッシュメモリに格納する中間コード形式のプログラム）
+// 作成 2026/10/19
+//
+// [利用方法]
+// ・SAVE ROM "名前" で、プログラム領域のプログラムをこのファイルの定義形式で出力する
+//   出力結果をこのファイルに貼り付け、ROMPRG_TABLEに登録してスケッチを書き込む
+// ・RUN ROM 番号|"名前" で実行、LOAD ROM 番号|"名前" でプログラム領域にロード、
+//   FILES ROM で一覧表示する
+//
+// [データ形式]
+// ・プログラム領域と同じ中間コード形式(行長(1)+行番号(2)+中間コード+I_EOL)の並び
+//   終端の行長0は不要
+// ・SAVE ROMの出力は中間コード番号の数値のため、キーワードの追加・変更で中間コード番号が
+//   変わった場合は再出力すること(手で記述する場合は列挙子(I_PRINT等)も利用可能)
+//
+
+#ifndef __romprg_h__
+#define __romprg_h__
+
+// 10 PRINT "Hello"
+const uint8_t romprg_HELLO[] PROGMEM = {
+  12,10,0,I_PRINT,I_STR,5,'H','e','l','l','o',I_EOL,
+};
+
+// ROMプログラムの登録(名前は最大8文字、英大文字)
+#define ROMPRG_TABLE \
+  ROMPRG("HELLO", romprg_HELLO),
+
+#endif
@@ -0,0 +1,479 @@
+//
+// TEEPROM 内部EEPROMクラス 簡易プログラム保存管理
+// 作成 2026/10/19
+// 修正 2026/10/19 EE_READY割り込みによるバックグラウンド書込み対応
+// 修正 2026/10/19 未使用領域の消去(wipe)の追加
+// 修正 2026/10/19 ディレクトリのリング化(世代番号+CRC)、書込み位置の分散(ウェアレベリング)対応
+// 修正 2026/10/19 保存データのCRCチェック(check)の追加
+// 修正 2026/10/19 保存時の前置データ(ヘッダー)指定の追加
+// 修正 2026/10/19 複数の領域を連結した保存(分割データの保存)の追加
+// 修正 2026/10/19 保存時に旧データの領域を上書きしない、詰め直しで移動元を壊さないように修正(電源断対策)
+//
+
+#include "TEEPROM.h"
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <util/crc16.h>
+
+#define SIGN0         'T'  // シグニチャ
+#define SIGN1         'E'
+#define VERSION       2    // フォーマットバージョン
+#define HEADSIZE      5    // ヘッダーサイズ
+#define POS_DIR       HEADSIZE              // ディレクトリ位置
+#define RINGNUM_STD   2    // ディレクトリレコード数(通常時)
+#define POS_REC(n)    (POS_DIR+sizeof(teeprom_rec_t)*(n)) // ディレクトリレコード位置
+#define DATAEND       (E2END+1)             // データ領域末尾+1
+#define SKIPMAX       8    // 割り込み1回当たりの書込み不要バイトの最大スキップ数
+
+volatile teeprom_job_t TEEPROM::_job[TEEPROM_JOBNUM];
+volatile uint8_t TEEPROM::_jobi = 0;
+volatile uint8_t TEEPROM::_jobn = 0;
+
+////////////////////////////////////////////////////
+// EEPROM書込み可能割り込み
+////////////////////////////////////////////////////
+ISR(EE_READY_vect) {
+  TEEPROM::isr();
+}
+
+////////////////////////////////////////////////////
+// 割り込み処理(次の1バイトの書込み開始)
+// 内容が同じバイトは書込みを省略する
+////////////////////////////////////////////////////
+void TEEPROM::isr() {
+  uint8_t d;
+  uint8_t skip = SKIPMAX;
+
+  while (_jobi < _jobn) {
+    volatile teeprom_job_t* j = &_job[_jobi];
+    if (!j->len) {
+      _jobi++;
+      continue;
+    }
+    d = *j->src++;
+    EEAR = j->addr++;
+    j->len--;
+    EECR |= _BV(EERE);
+    if (EEDR != d) {
+      // 書込み開始(消去+書込み)
+      EEDR = d;
+      EECR = _BV(EERIE) | _BV(EEMPE);
+      EECR |= _BV(EEPE);
+      return;
+    }
+    if (!--skip)
+      return;  // 他の割り込みを待たせないよう一旦抜ける
+  }
+  // 全ジョブ完了
+  _jobi = _jobn = 0;
+  EECR &= ~_BV(EERIE);
+}
+
+////////////////////////////////////////////////////
+// 書込みジョブの登録(書込み停止中に呼び出すこと)
+////////////////////////////////////////////////////
+void TEEPROM::queue(const uint8_t* src, uint16_t addr, uint16_t len) {
+  _job[_jobn].src  = src;
+  _job[_jobn].addr = addr;
+  _job[_jobn].len  = len;
+  _jobn++;
+}
+
+////////////////////////////////////////////////////
+// 書込み残りバイト数の取得
+// 戻り値
+//  0:書込み完了 0以外:書込み中
+////////////////////////////////////////////////////
+uint16_t TEEPROM::busy() {
+  uint16_t n = 0;
+  uint8_t  sreg = SREG;
+  cli();
+  for (uint8_t i = _jobi; i < _jobn; i++)
+    n += _job[i].len;
+  if (!n && _jobn)
+    n = 1;  // 最後の1バイトの書込み中
+  SREG = sreg;
+  return n;
+}
+
+////////////////////////////////////////////////////
+// 書込み完了待ち
+////////////////////////////////////////////////////
+void TEEPROM::flush() {
+  while (_jobn);
+}
+
+////////////////////////////////////////////////////
+// コンストラクタ
+////////////////////////////////////////////////////
+TEEPROM::TEEPROM(uint8_t flgWL) {
+  _flgWL   = flgWL;
+  _ring    = flgWL ? TEEPROM_RINGNUM : RINGNUM_STD;
+  _top     = POS_REC(_ring);
+  _flgInit = 0;
+}
+
+////////////////////////////////////////////////////
+// レコードのCRC計算(CRC16自身を除く)
+////////////////////////////////////////////////////
+uint16_t TEEPROM::recCrc() {
+  uint16_t c = 0xffff;
+  for (uint8_t i = 0; i < sizeof(teeprom_rec_t) - sizeof(uint16_t); i++)
+    c = _crc16_update(c, ((uint8_t*)&_rec)[i]);
+  return c;
+}
+
+////////////////////////////////////////////////////
+// ディレクトリの読込み
+// 全レコードからCRCが正しく世代番号が最も新しいものを採用する
+// シグニチャが一致しない場合、有効なレコードがない場合は、全て空きとする
+////////////////////////////////////////////////////
+void TEEPROM::begin() {
+  uint16_t seq = 0;
+  uint8_t  k = 0xff;
+
+  if (_flgInit)
+    return;
+  _flgInit = 1;
+  _flgHead = ( eeprom_read_byte((uint8_t*)0) == SIGN0 && eeprom_read_byte((uint8_t*)1) == SIGN1 &&
+               eeprom_read_byte((uint8_t*)2) == VERSION && eeprom_read_byte((uint8_t*)3) == TEEPROM_SLOTNUM &&
+               eeprom_read_byte((uint8_t*)4) == _ring );
+  if (_flgHead) {
+    for (uint8_t i = 0; i < _ring; i++) {
+      eeprom_read_block((void*)&_rec, (void*)POS_REC(i), sizeof(_rec));
+      if (_rec.crc == recCrc() && (k == 0xff || (int16_t)(_rec.seq - seq) > 0)) {
+        k   = i;
+        seq = _rec.seq;
+      }
+    }
+  }
+  if (k != 0xff) {
+    eeprom_read_block((void*)&_rec, (void*)POS_REC(k), sizeof(_rec));
+    _pos = k;
+  } else {
+    memset(&_rec, 0, sizeof(_rec));
+    _rec.next = _top;
+    _pos = _ring - 1;
+  }
+}
+
+////////////////////////////////////////////////////
+// ディレクトリの書込み(リングの次の位置に次世代のレコードを書込み)
+// ヘッダーは未書込みの場合のみ書き込む
+// 引数
+//  flgWait : 0:書込みジョブとして登録 1:書込み完了まで待つ
+////////////////////////////////////////////////////
+void TEEPROM::writeDir(uint8_t flgWait) {
+  if (!_flgHead) {
+    uint8_t head[HEADSIZE] = { SIGN0, SIGN1, VERSION, TEEPROM_SLOTNUM, _ring };
+    eeprom_update_block((void*)head, (void*)0, HEADSIZE);
+    _flgHead = 1;
+  }
+  _rec.seq++;
+  _rec.crc = recCrc();
+  if (++_pos >= _ring)
+    _pos = 0;
+  if (flgWait)
+    eeprom_update_block((void*)&_rec, (void*)POS_REC(_pos), sizeof(_rec));
+  else
+    queue((uint8_t*)&_rec, POS_REC(_pos), sizeof(_rec));
+}
+
+////////////////////////////////////////////////////
+// 空き領域の検索(検索開始位置以降で最初に収まる位置)
+// 末尾までに収まらない場合は、データ領域先頭から探し直す
+// 引数
+//  no   : 検索対象外とする保存番号(0xff:全て対象)
+//  len  : 必要サイズ
+//  from : 検索開始位置
+// 戻り値
+//  0   : 空き領域なし
+//  0以外: 先頭アドレス
+////////////////////////////////////////////////////
+uint16_t TEEPROM::findSpace(uint8_t no, uint16_t len, uint16_t from) {
+  uint16_t addr = from;
+  uint8_t  i;
+
+  for (;;) {
+    // 候補位置と重なる保存領域を探す
+    for (i = 0; i < TEEPROM_SLOTNUM; i++) {
+      if (i != no && _rec.dir[i].len &&
+          _rec.dir[i].addr < addr + len && addr < _rec.dir[i].addr + _rec.dir[i].len)
+        break;
+    }
+    if (i < TEEPROM_SLOTNUM) {
+      addr = _rec.dir[i].addr + _rec.dir[i].len;  // 重なった領域の直後を次の候補とする
+    } else if (addr + len <= DATAEND) {
+      return addr;
+    } else if (from != _top) {
+      addr = from = _top;  // 先頭から探し直す
+    } else {
+      return 0;
+    }
+  }
+}
+
+////////////////////////////////////////////////////
+// 保存領域の移動(移動先は移動元と重ならないこと)
+// コピー後にディレクトリを更新する(途中で電源断した場合は移動元が残る)
+// 引数
+//  no : 保存番号
+//  to : 移動先アドレス
+////////////////////////////////////////////////////
+void TEEPROM::move(uint8_t no, uint16_t to) {
+  for (uint16_t i = 0; i < _rec.dir[no].len; i++)
+    eeprom_update_byte((uint8_t*)(to+i), eeprom_read_byte((uint8_t*)(_rec.dir[no].addr+i)));
+  _rec.dir[no].addr = to;
+  writeDir();
+}
+
+////////////////////////////////////////////////////
+// 保存領域の詰め直し
+// アドレス順に前方へ移動し、空き領域を末尾にまとめる
+// 移動先が移動元と重なる場合は、空き領域を経由して移動する
+// (経由する空き領域がない場合は移動せず、以降の保存領域の詰め直しを続ける)
+////////////////////////////////////////////////////
+void TEEPROM::compact() {
+  uint16_t top = _top;
+  uint16_t tmp;
+  uint8_t  k;
+
+  for (;;) {
+    // top以降で最も前にある保存領域を探す
+    k = TEEPROM_SLOTNUM;
+    for (uint8_t i = 0; i < TEEPROM_SLOTNUM; i++) {
+      if (_rec.dir[i].len && _rec.dir[i].addr >= top && (k == TEEPROM_SLOTNUM || _rec.dir[i].addr < _rec.dir[k].addr))
+        k = i;
+    }
+    if (k == TEEPROM_SLOTNUM)
+      break;
+
+    if (_rec.dir[k].addr != top) {
+      if (_rec.dir[k].addr - top < _rec.dir[k].len) {
+        // 重なる場合は移動元の後方の空き領域に一旦移動する
+        if ( (tmp = findSpace(0xff, _rec.dir[k].len, top)) )
+          move(k, tmp);
+        else
+          top = _rec.dir[k].addr;  // 経由する空き領域がない場合は移動しない
+      }
+      if (_rec.dir[k].addr != top)
+        move(k, top);
+    }
+    top += _rec.dir[k].len;
+  }
+  _rec.next = top;
+}
+
+////////////////////////////////////////////////////
+// 保存データ長の取得
+// 引数
+//  no : 保存番号
+// 戻り値
+//  保存データ長(0:データなし)
+////////////////////////////////////////////////////
+uint16_t TEEPROM::size(uint8_t no) {
+  begin();
+  return _rec.dir[no].len;
+}
+
+////////////////////////////////////////////////////
+// 空き容量の取得
+////////////////////////////////////////////////////
+uint16_t TEEPROM::freeSize() {
+  uint16_t sz = DATAEND - _top;
+  begin();
+  for (uint8_t i = 0; i < TEEPROM_SLOTNUM; i++)
+    sz -= _rec.dir[i].len;
+  return sz;
+}
+
+////////////////////////////////////////////////////
+// データのロード
+// 引数
+//  no  : 保存番号
+//  ptr : データ格納アドレス
+//  len : 格納領域サイズ
+// 戻り値
+//   0: 正常
+//   1: CRC不一致
+//   2: データなし
+//   3: 格納領域サイズ不足
+////////////////////////////////////////////////////
+uint8_t TEEPROM::load(uint8_t no, uint8_t* ptr, uint16_t len) {
+  uint16_t c = 0xffff;
+
+  flush();
+  begin();
+  if (!_rec.dir[no].len)
+    return 2;
+  if (_rec.dir[no].len > len)
+    return 3;
+  eeprom_read_block((void*)ptr, (void*)_rec.dir[no].addr, _rec.dir[no].len);
+  for (uint16_t i = 0; i < _rec.dir[no].len; i++)
+    c = _crc16_update(c, ptr[i]);
+  return (c == _rec.dir[no].crc) ? 0 : 1;
+}
+
+////////////////////////////////////////////////////
+// 保存データのCRCチェック(EEPROM上のデータを直接チェックする)
+// 引数
+//  no  : 保存番号
+// 戻り値
+//   0: 正常
+//   1: CRC不一致
+//   2: データなし
+////////////////////////////////////////////////////
+uint8_t TEEPROM::check(uint8_t no) {
+  uint16_t c = 0xffff;
+
+  flush();
+  begin();
+  if (!_rec.dir[no].len)
+    return 2;
+  for (uint16_t i = 0; i < _rec.dir[no].len; i++)
+    c = _crc16_update(c, eeprom_read_byte((uint8_t*)(_rec.dir[no].addr + i)));
+  return (c == _rec.dir[no].crc) ? 0 : 1;
+}
+
+////////////////////////////////////////////////////
+// データの部分読込み(保存データ長を超える部分は読み込まない)
+// 引数
+//  no  : 保存番号
+//  pos : データ内読込み位置
+//  ptr : データ格納アドレス
+//  len : 読込みデータ長
+// 戻り値
+//   0: 正常
+//   2: データなし
+////////////////////////////////////////////////////
+uint8_t TEEPROM::read(uint8_t no, uint16_t pos, uint8_t* ptr, uint16_t len) {
+  flush();
+  begin();
+  if (pos >= _rec.dir[no].len)
+    return 2;
+  if (pos + len > _rec.dir[no].len)
+    len = _rec.dir[no].len - pos;
+  eeprom_read_block((void*)ptr, (void*)(_rec.dir[no].addr + pos), len);
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// データの保存
+// 引数
+//  no  : 保存番号
+//  ptr : データ格納アドレス
+//  len : データ長
+//  flgWait : 0:バックグラウンドで書込み(書込み完了までptr、headの内容を変更しないこと)
+//            1:書込み完了まで待つ
+//  head : 前置データ(データの前に続けて保存する、NULL:なし)
+//  hlen : 前置データ長
+// 戻り値
+//   0: 正常
+//   2: 保存領域なし
+////////////////////////////////////////////////////
+uint8_t TEEPROM::save(uint8_t no, uint8_t* ptr, uint16_t len, uint8_t flgWait, const uint8_t* head, uint8_t hlen) {
+  teeprom_seg_t seg[2] = { { head, hlen }, { ptr, len } };
+  return save(no, seg, 2, flgWait);
+}
+
+////////////////////////////////////////////////////
+// 分割データの保存
+// 複数の領域のデータを指定順に連結して1つのデータとして保存する
+// 引数
+//  no  : 保存番号
+//  seg : 分割データの指定(データ長0の指定は無視する)
+//  n   : 分割数(1～TEEPROM_SEGNUM)
+//  flgWait : 0:バックグラウンドで書込み(書込み完了まで各データの内容を変更しないこと)
+//            1:書込み完了まで待つ
+// 戻り値
+//   0: 正常
+//   2: 保存領域なし(旧データを残したまま保存出来る空きがない)
+////////////////////////////////////////////////////
+uint8_t TEEPROM::save(uint8_t no, const teeprom_seg_t* seg, uint8_t n, uint8_t flgWait) {
+  uint16_t addr, from, pos;
+  uint16_t len = 0;
+  uint16_t c = 0xffff;
+
+  flush();
+  begin();
+  for (uint8_t i = 0; i < n; i++)
+    len += seg[i].len;
+  if (!len)
+    return del(no);
+  if (len > freeSize())
+    return 2;  // 旧データを残したまま保存出来ない(旧データの上書きはしない)
+
+  // 保存位置の決定
+  // 電源断で旧データを失わないように、旧データを残したまま保存出来る位置とする
+  // ウェアレベリング時は前回の書込み位置の直後から探す
+  from = (_flgWL && _rec.next >= _top && _rec.next < DATAEND) ? _rec.next : _top;
+  if ( !(addr = findSpace(0xff, len, from)) ) {
+    // 断片化で確保出来ない場合は旧データも含めて詰め直し、末尾に確保する
+    compact();
+    if ( !(addr = findSpace(0xff, len, _top)) )
+      return 2;  // 詰め直し出来なかった
+  }
+
+  // データの書込み(指定順)
+  pos = addr;
+  for (uint8_t i = 0; i < n; pos += seg[i].len, i++) {
+    if (!seg[i].len)
+      continue;
+    for (uint16_t j = 0; j < seg[i].len; j++)
+      c = _crc16_update(c, seg[i].ptr[j]);
+    if (flgWait)
+      eeprom_update_block((const void*)seg[i].ptr, (void*)pos, seg[i].len);
+    else
+      queue(seg[i].ptr, pos, seg[i].len);
+  }
+
+  // ディレクトリの更新
+  _rec.dir[no].addr = addr;
+  _rec.dir[no].len  = len;
+  _rec.dir[no].crc  = c;
+  _rec.next = addr + len;
+  writeDir(flgWait);
+  if (!flgWait)
+    EECR |= _BV(EERIE);  // バックグラウンド書込み開始
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// データの削除(ディレクトリのエントリのみ無効化)
+// 引数
+//  no  : 保存番号
+// 戻り値
+//   0: 正常
+////////////////////////////////////////////////////
+uint8_t TEEPROM::del(uint8_t no) {
+  flush();
+  begin();
+  if (_rec.dir[no].len) {
+    memset(&_rec.dir[no], 0, sizeof(teeprom_dir_t));
+    writeDir();
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// 未使用領域の消去(0xFFで上書き)
+// 削除済みデータや保存位置変更前の旧データを消去する
+////////////////////////////////////////////////////
+void TEEPROM::wipe() {
+  uint16_t addr;
+  uint8_t  i;
+
+  flush();
+  begin();
+  addr = _top;
+  while (addr < DATAEND) {
+    for (i = 0; i < TEEPROM_SLOTNUM; i++) {
+      if (_rec.dir[i].len && _rec.dir[i].addr <= addr && addr < _rec.dir[i].addr + _rec.dir[i].len)
+        break;
+    }
+    if (i < TEEPROM_SLOTNUM)
+      addr = _rec.dir[i].addr + _rec.dir[i].len;  // 使用中の領域はスキップ
+    else
+      eeprom_update_byte((uint8_t*)addr++, 0xff);
+  }
+}
@@ -0,0 +1,132 @@
+//
+// TEEPROM 内部EEPROMクラス 簡易プログラム保存管理
+// 作成 2026/10/19
+// 修正 2026/10/19 EE_READY割り込みによるバックグラウンド書込み対応
+// 修正 2026/10/19 未使用領域の消去(wipe)の追加
+// 修正 2026/10/19 ディレクトリのリング化(世代番号+CRC)、書込み位置の分散(ウェアレベリング)対応
+// 修正 2026/10/19 保存データのCRCチェック(check)の追加
+// 修正 2026/10/19 保存時の前置データ(ヘッダー)指定の追加
+// 修正 2026/10/19 複数の領域を連結した保存(分割データの保存)の追加
+// 修正 2026/10/19 保存時に旧データの領域を上書きしない、詰め直しで移動元を壊さないように修正(電源断対策)
+//
+
+#ifndef __TEEPROM_H__
+#define __TEEPROM_H__
+
+/*
+このライブラリは、AVR内部EEPROMに可変長のプログラム保存領域を構築するためのものです。
+用途としては、Tiny BASICでのプログラムの保存を想定しています。
+
+[仕様]
+・保存番号毎にデータ長とCRCをディレクトリで管理し、利用分のみ読み書きする
+・保存領域は可変長で、空き領域に先頭から詰めて配置する
+  空き領域が断片化して確保出来ない場合は、保存領域の再配置(詰め直し)を行う
+・ディレクトリは世代番号とCRC付きのレコードとし、複数レコードのリングに順番に書き込む
+  起動後の初回アクセス時に全レコードを調べ、CRCが正しく世代番号が最も新しいものを採用する
+  (書込み途中で電源断したレコードは無視され、1つ前の世代が有効となる)
+・ウェアレベリング指定時は、リングのレコード数を増やし、保存位置を前回の書込み位置の
+  直後から探す(次の空き位置に順番に配置する)ことで書込み箇所をEEPROM全体に分散する
+・ディレクトリはSRAM上に保持し、初回アクセス時にEEPROMから読み込む
+・保存はEE_READY割り込みによるバックグラウンド書込みが可能
+  書込み中のデータ領域は書込み完了まで変更しないこと
+  (書込み中に保存・読込み等の操作を行った場合は、書込み完了を待ってから処理する)
+  書込み順はデータ、ディレクトリの順とし、途中で電源断した場合は旧データが残る
+  (旧データの領域には上書きしないため、保存には旧データを残したままの空きが必要)
+
+・EEPROMのデータフォーマット(括弧内はバイトサイズ)
+   0x0000 - 0x0004: ヘッダー部(5) : シグニチャ(2)+バージョン(1)+保存数(1)+レコード数(1)
+   0x0005 -       : ディレクトリレコード(4+6x保存数+2) x レコード数
+     レコード : 世代番号(2)+次回保存位置(2)+エントリ(6x保存数)+CRC16(2)
+     エントリ(6) : 先頭アドレス(2)+データ長(2)+CRC16(2)
+        データ長0の場合は保存データなし
+   ディレクトリ以降 - E2END : データ領域
+
+ 保存数・レコード数の想定
+                             保存数  レコード数(通常/ウェアレベリング)
+   1kバイト (Uno)          : 4       2/4
+   4kバイト (MEGA2560,1284) : 8       2/8
+*/
+
+#include <Arduino.h>
+
+#if E2END < 0x7FF
+  #define TEEPROM_SLOTNUM   4  // 保存数
+  #define TEEPROM_RINGNUM   4  // ディレクトリレコード数(ウェアレベリング時)
+#else
+  #define TEEPROM_SLOTNUM   8  // 保存数
+  #define TEEPROM_RINGNUM   8  // ディレクトリレコード数(ウェアレベリング時)
+#endif
+
+// ディレクトリエントリ
+typedef struct {
+  uint16_t addr;   // 先頭アドレス
+  uint16_t len;    // データ長(0:データなし)
+  uint16_t crc;    // CRC16
+} teeprom_dir_t;
+
+// ディレクトリレコード
+typedef struct {
+  uint16_t seq;                         // 世代番号
+  uint16_t next;                        // 次回保存位置(ウェアレベリング時)
+  teeprom_dir_t dir[TEEPROM_SLOTNUM];   // エントリ
+  uint16_t crc;                         // レコードのCRC16
+} teeprom_rec_t;
+
+// 保存データの分割指定
+typedef struct {
+  const uint8_t* ptr;  // データ格納アドレス
+  uint16_t len;        // データ長
+} teeprom_seg_t;
+
+#define TEEPROM_SEGNUM  4  // 保存データの最大分割数
+
+// バックグラウンド書込みジョブ
+typedef struct {
+  const uint8_t* src;  // 書込みデータ
+  uint16_t addr;       // 書込み先アドレス
+  uint16_t len;        // 残りバイト数
+} teeprom_job_t;
+
+#define TEEPROM_JOBNUM  (TEEPROM_SEGNUM+1)  // ジョブ数(分割データ、ディレクトリ)
+
+class TEEPROM {
+ private:
+   teeprom_rec_t _rec;                    // ディレクトリ(最新レコード)
+   uint16_t _top;                         // データ領域先頭
+   uint8_t _ring;                         // ディレクトリレコード数
+   uint8_t _pos;                          // 最新レコードの位置
+   uint8_t _flgWL;                        // ウェアレベリングフラグ
+   uint8_t _flgInit;                      // ディレクトリ読込み済みフラグ
+   uint8_t _flgHead;                      // ヘッダー書込み済みフラグ
+   static volatile teeprom_job_t _job[TEEPROM_JOBNUM]; // 書込みジョブ
+   static volatile uint8_t _jobi;                      // 実行中ジョブ
+   static volatile uint8_t _jobn;                      // 登録ジョブ数
+
+   void begin();                                             // ディレクトリの読込み
+   void writeDir(uint8_t flgWait=1);                         // ディレクトリの書込み
+   void queue(const uint8_t* src, uint16_t addr, uint16_t len); // 書込みジョブの登録
+   uint16_t recCrc();                                        // レコードのCRC計算
+   uint16_t findSpace(uint8_t no, uint16_t len, uint16_t from); // 空き領域の検索
+   void move(uint8_t no, uint16_t to);                       // 保存領域の移動
+   void compact();                                           // 保存領域の詰め直し
+
+ public:
+   TEEPROM(uint8_t flgWL=0);                                 // コンストラクタ
+   uint8_t maxFiles() { return TEEPROM_SLOTNUM; };           // 保存数の取得
+   uint16_t size(uint8_t no);                                // 保存データ長の取得
+   uint16_t freeSize();                                      // 空き容量の取得
+   uint8_t load(uint8_t no, uint8_t* ptr, uint16_t len);     // データのロード
+   uint8_t read(uint8_t no, uint16_t pos, uint8_t* ptr, uint16_t len); // データの部分読込み
+   uint8_t check(uint8_t no);                                // 保存データのCRCチェック
+   uint8_t save(uint8_t no, uint8_t* ptr, uint16_t len, uint8_t flgWait=1,
+                const uint8_t* head=NULL, uint8_t hlen=0);   // データの保存
+   uint8_t save(uint8_t no, const teeprom_seg_t* seg, uint8_t n,
+                uint8_t flgWait=1);                          // 分割データの保存
+   uint8_t del(uint8_t no);                                  // データの削除
+   void wipe();                                              // 未使用領域の消去
+   uint16_t busy();                                          // 書込み残りバイト数の取得
+   void flush();                                             // 書込み完了待ち
+   static void isr();                                        // 割り込み処理(EE_READY)
+};
+
+#endif
@@ -2,121 +2,486 @@
 // TI2CEEPROM I2C接続EEPROMクラス 簡易ファイルシステム
 // 作成 2018/02/25 by たま吉さん
 // 修正 2019/05/28 by たま吉さん,スペルミスTI2CEPPROMをTI2CEEPROMに修正,gccワーニング修正
+// 修正 2026/10/19 ページ単位の書込み、ACKポーリングによる書込み完了待ち、読込みの一括転送化
+// 修正 2026/10/19 ヘッダー、ファイル管理テーブルのSRAMキャッシュ対応
+// 修正 2026/10/19 ブロック割当て表による可変長ファイル、64kバイト超のEEPROM、詰め直しの対応
+// 修正 2026/10/19 比較書込み(内容が異なる部分のみ書込み)、保存時の既存ブロックの再利用
+// 修正 2026/10/19 データファイルへの追記(書込みバッファ、オープン時の回復処理)対応
+// 修正 2026/10/19 保存時の前置データ(ヘッダー)指定の追加
+// 修正 2026/10/19 データファイル以外への追記(オープン時のファイル種別指定)対応
+// 修正 2026/10/19 保存時は新しいブロックに書き込んでから切り替えるように修正(電源断対策)
+// 修正 2026/10/19 読込みのみのオープン時は回復処理の書込みを行わないように修正
 //
 
 #include "TI2CEEPROM.h"
 #include <Wire.h>
 
-#define BLKSIE        16 // 一回ごとのアクセスバイト数(I2Cのバッファ32バイト制限考慮)
-#define HEADSIZE      16 // ヘッダーサイズ
+// 一回ごとのアクセスバイト数(Wireライブラリのバッファサイズ制限考慮)
+#ifdef BUFFER_LENGTH
+  #define RD_BLKSIZE  BUFFER_LENGTH      // 読込み(受信バッファサイズ)
+  #define WR_BLKSIZE  (BUFFER_LENGTH-2)  // 書込み(送信バッファサイズ-アドレス2バイト)
+#else
+  #define RD_BLKSIZE  32
+  #define WR_BLKSIZE  30
+#endif
+#define WR_TIMEOUT    20 // 書込み完了待ちタイムアウト(ミリ秒)
+#define CP_BLKSIZE    16 // ブロック入れ替え時の転送バイト数(ページサイズの約数)
+#define HEADSIZE      32 // ヘッダーサイズ
 #define FILEINFOSIZE  16 // ファイル管理情報サイズ
+#define FHEADSIZE     4  // ファイル先頭のファイル長サイズ
 #define POS_SIGN      0  // シグニチャ名位置
 #define POS_VOLUME    4  // ボリューム名位置
 #define POS_RCDNUM    14 // レコード数位置
+#define POS_FORMAT    15 // フォーマット識別位置
+#define POS_BSHIFT    16 // ブロックサイズ位置
+#define POS_NBLK      17 // ブロック数位置
+#define POS_ASEL      18 // ブロック選択ビット位置の位置
+#define POS_PGSIZE    19 // ページサイズ位置
+#define POS_DATATOP   20 // データ領域先頭位置
 #define POS_FTYPE     14 // ファイルタイプ位置
-#define POS_BSIZE     15 // ブロックサイズ位置
+#define POS_FBLK      15 // 先頭ブロック番号位置
 
 #define SZ_SIGN      4   // シグニチャ名バイト数
 #define SZ_VOLUME    10  // ボリューム名バイト数
-#define SZ_RCDNUM    1   // レコード数バイト数
-#define SZ_FTYPE     1   // ファイルタイプバイト数
-#define SZ_BSIZE     1   // ブロックサイズバイト数
 #define SZ_FNAME     14  // ファイル名バイト数
 
-// 16バイト迄の読み込み
-uint8_t TI2CEEPROM::read16(uint16_t addr, uint8_t* buf,uint16_t len) {
-  Wire.beginTransmission(_devaddr);
-  Wire.write(addr >> 8);     // 上位アドレス
-  Wire.write(addr & 0xff);   // 下位アドレス
-  Wire.endTransmission(false);
-  Wire.requestFrom(_devaddr, (uint8_t)len);
-  for (uint16_t i = 0; i < len ; i++ ,buf++) {
-    *buf = Wire.read();         
+#define FORMAT_ID    0x82 // フォーマット識別
+#define BSHIFT_MIN   6    // 最小ブロックサイズ(64バイト)
+#define BSHIFT_MAX   12   // 最大ブロックサイズ(4096バイト)
+
+#define FAT_FREE     0x00 // 空きブロック
+#define FAT_END      0xFF // 最終ブロック
+#define FAT_RSV      0xFE // 予約(読込みエラー時もこの値とする)
+
+#define NBLK         (_head[POS_NBLK])
+#define BSHIFT       (_head[POS_BSHIFT])
+#define ISBLK(b)     ((b) >= 1 && (b) <= NBLK)
+
+////////////////////////////////////////////////////
+// アクセス先I2Cスレーブアドレスの取得
+// 64kバイトを超えるアドレスは、ブロック選択ビットに上位アドレスを設定する
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::devAddr(uint32_t addr) {
+  return _devaddr | (uint8_t)((addr >> 16) << _asel);
+}
+
+////////////////////////////////////////////////////
+// 一括読込み(Wireの受信バッファサイズ迄、64kバイト境界を跨がないこと)
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::readBlk(uint32_t addr, uint8_t* buf, uint8_t len) {
+  uint8_t  rc;
+  uint8_t  dev = devAddr(addr);
+  Wire.beginTransmission(dev);
+  Wire.write((uint8_t)(addr >> 8));   // 上位アドレス
+  Wire.write((uint8_t)addr);          // 下位アドレス
+  if ( (rc = Wire.endTransmission(false)) )
+    return rc;
+  if (Wire.requestFrom(dev, len) != len)
+    return 4;
+  for (uint8_t i = 0; i < len ; i++ ,buf++) {
+    *buf = Wire.read();
   }
-  return  Wire.endTransmission();
+  return 0;
 }
 
 ////////////////////////////////////////////////////
 // 指定アドレスのデータ読込
 // 引数
-//  addr : EEPROM データ読込先頭アドレス(0 ～ 0xFFFF)
+//  addr : EEPROM データ読込先頭アドレス
 //  buf  : 読込データ格納アドレス
 //  len  : 読込データ長さ
 // 戻り値
-//  0: 正常終了、1～4:I2Cデバイスエラー 
+//  0: 正常終了、1～4:I2Cデバイスエラー
 ////////////////////////////////////////////////////
-uint8_t TI2CEEPROM::read(uint16_t addr, uint8_t* buf,uint16_t len) {
+uint8_t TI2CEEPROM::read(uint32_t addr, uint8_t* buf,uint16_t len) {
   uint8_t  rc;
-  uint16_t cnt = len / BLKSIE; 
-  uint16_t rst = len % BLKSIE;
-  //uint16_t pos = 0;
-
-  // Wireのバッファサイズ対策のため、16バイト毎に読込を行う
-  for (uint8_t i=0; i < cnt; i++, addr += BLKSIE,buf+=BLKSIE) {    
-    // 16バイト読込トランザクション
-    if ( (rc = this->read16(addr, buf, 16)) )
-      return rc;
-  }
+  uint32_t n;
 
-  // 16バイト未満の読み込み
-  if (rst) {
-    if ( (rc = this->read16(addr, buf, rst)) )
+  // 連続読込みはページ境界の制限がないため、Wireのバッファサイズ毎に読込を行う
+  // (ブロック選択ビットが変わる64kバイト境界では分割する)
+  while (len) {
+    n = 0x10000 - (addr & 0xffff);
+    if (n > RD_BLKSIZE) n = RD_BLKSIZE;
+    if (n > len)        n = len;
+    if ( (rc = this->readBlk(addr, buf, n)) )
       return rc;
+    addr += n; buf += n; len -= n;
   }
   return 0;
 }
 
-// 16バイト迄の書込み
-uint8_t TI2CEEPROM::write16(uint16_t addr, uint8_t* buf, uint16_t len) {
+////////////////////////////////////////////////////
+// 書込み完了待ち(ACKポーリング)
+// 書込みサイクル中のEEPROMはスレーブアドレスにACKを返さない
+// 引数
+//  dev : I2Cスレーブアドレス
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー(タイムアウト)
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::waitReady(uint8_t dev) {
   uint8_t  rc;
-  Wire.beginTransmission(_devaddr);
-  Wire.write(addr >> 8);     // 上位アドレス
-  Wire.write(addr & 0xff);   // 下位アドレス
-  Wire.write(buf,len); 
-  rc = Wire.endTransmission();
-  delay(5);
+  uint32_t tm = millis();
+  do {
+    Wire.beginTransmission(dev);
+    if ( !(rc = Wire.endTransmission()) )
+      break;
+  } while (millis() - tm < WR_TIMEOUT);
   return rc;
 }
 
+////////////////////////////////////////////////////
+// 一括書込み(ページ境界を跨がないこと、Wireの送信バッファサイズ迄)
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::writeBlk(uint32_t addr, uint8_t* buf, uint8_t len) {
+  uint8_t  rc;
+  uint8_t  dev = devAddr(addr);
+  Wire.beginTransmission(dev);
+  Wire.write((uint8_t)(addr >> 8));   // 上位アドレス
+  Wire.write((uint8_t)addr);          // 下位アドレス
+  Wire.write(buf,len);
+  if ( (rc = Wire.endTransmission()) )
+    return rc;
+  return this->waitReady(dev);
+}
+
 ////////////////////////////////////////////////////
 // 指定アドレスへのデータ書込み
 // 引数
-//  addr : EEPROM データ書込み先頭アドレス(0 ～ 0xFFFF)
+//  addr : EEPROM データ書込み先頭アドレス
 //  buf  : 書込みデータ格納アドレス
 //  len  : 書込みデータ長さ
 // 戻り値
-//  0: 正常終了、1～4:I2Cデバイスエラー 
-
+//  0: 正常終了、1～4:I2Cデバイスエラー
 ////////////////////////////////////////////////////
-uint8_t TI2CEEPROM::write(uint16_t addr, uint8_t* buf, uint16_t len) {
+uint8_t TI2CEEPROM::write(uint32_t addr, uint8_t* buf, uint16_t len) {
   uint8_t  rc;
-  uint16_t cnt = len / BLKSIE;
-  uint16_t rst = len % BLKSIE;
-  //uint16_t pos = 0;
-
-  // Wireのバッファサイズ対策のため、16バイト毎に読込を行う
-  for (uint16_t i=0; i < cnt; i++,buf+=BLKSIE,addr+=BLKSIE) {
-    // 16バイト書込みトランザクション
-    if ( (rc = this->write16(addr,buf, 16)) ) 
+  uint16_t n;
+
+  // ページ境界を跨がないように、Wireのバッファサイズ以内に分割して書込みを行う
+  while (len) {
+    n = _pgsize - (addr & (_pgsize-1));  // ページ内の残りバイト数
+    if (n > WR_BLKSIZE) n = WR_BLKSIZE;
+    if (n > len)        n = len;
+    if ( (rc = this->writeBlk(addr, buf, n)) )
       return rc;
+    addr += n; buf += n; len -= n;
   }
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// 指定アドレスへのデータ書込み(内容が異なる部分のみ書込み)
+// 書込み単位毎に読込んで比較し、一致する場合は書込みを省略する
+// 引数
+//  addr : EEPROM データ書込み先頭アドレス
+//  buf  : 書込みデータ格納アドレス
+//  len  : 書込みデータ長さ
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::update(uint32_t addr, uint8_t* buf, uint16_t len) {
+  uint8_t  rc;
+  uint8_t  tmp[WR_BLKSIZE];
+  uint16_t n;
 
-  // 16バイト未満書込みトランザクション
-  if (rst) {
-    if ( (rc = this->write16(addr,buf, rst)) ) 
+  while (len) {
+    n = _pgsize - (addr & (_pgsize-1));  // ページ内の残りバイト数
+    if (n > WR_BLKSIZE) n = WR_BLKSIZE;
+    if (n > len)        n = len;
+    if ( (rc = this->readBlk(addr, tmp, n)) )
       return rc;
+    if ( memcmp(tmp, buf, n) && (rc = this->writeBlk(addr, buf, n)) )
+      return rc;
+    addr += n; buf += n; len -= n;
   }
-  return 0;  
+  return 0;
 }
 
 ////////////////////////////////////////////////////
 // コンストラクタ
 // 引数
-//  addr: I2Cスレーブアドレス
+//  addr  : I2Cスレーブアドレス
+//  pgsize: EEPROMのページサイズ(2のべき乗)
 ////////////////////////////////////////////////////
-TI2CEEPROM::TI2CEEPROM(uint8_t addr) {
+TI2CEEPROM::TI2CEEPROM(uint8_t addr, uint8_t pgsize) {
   //_sz = sz;         // EEPROM容量(単位 kバイト)
-  _devaddr = addr;    // I2Cスレーブアドレス  
+  _devaddr = addr;    // I2Cスレーブアドレス
+  _pgsize  = pgsize;  // ページサイズ
+  _asel    = 0;       // ブロック選択ビット位置
+  _flgCache = 0;      // キャッシュ無効
+}
+
+////////////////////////////////////////////////////
+// ヘッダー、ファイル管理テーブル、ブロック割当て表のキャッシュへの読込み
+// (キャッシュが有効な場合は何もしない)
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー、5:未フォーマット
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::loadCache() {
+  uint8_t rc;
+
+  if (_flgCache)
+    return 0;
+  if ( (rc = this->read(0, _head, HEADSIZE)) )
+    return rc;
+  if (_head[POS_FORMAT] != FORMAT_ID || BSHIFT < BSHIFT_MIN || BSHIFT > BSHIFT_MAX ||
+      NBLK > TI2CEEPROM_NBLKMAX)
+    return 5;
+  _asel = _head[POS_ASEL];
+  if (_head[POS_PGSIZE])
+    _pgsize = _head[POS_PGSIZE];
+#if TI2CEEPROM_CACHENUM > 0
+  uint8_t n = _head[POS_RCDNUM];
+  if (n > TI2CEEPROM_CACHENUM)
+    n = TI2CEEPROM_CACHENUM;
+  if ( (rc = this->read(HEADSIZE, (uint8_t*)_tbl, FILEINFOSIZE*n)) )
+    return rc;
+  if ( (rc = this->read(fatAddr(), _fat, NBLK)) )
+    return rc;
+  _fatlo = 0xff;
+  _fathi = 0;
+#endif
+  _flgCache = 1;
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// ファイル管理テーブルの読込み
+// (キャッシュ対象外のテーブルはEEPROMから読み込む)
+// 引数
+//  index : テーブル番号
+//  buf   : 読込みデータ格納アドレス
+//  len   : 読込みデータ長さ(先頭から、16バイトまで)
+// 戻り値
+//  0: 正常終了、1～5:I2Cデバイスエラー
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::readEntry(uint8_t index, uint8_t* buf, uint8_t len) {
+  uint8_t rc;
+
+  if ( (rc = this->loadCache()) )
+    return rc;
+#if TI2CEEPROM_CACHENUM > 0
+  if (index < TI2CEEPROM_CACHENUM) {
+    memcpy(buf, _tbl[index], len);
+    return 0;
+  }
+#endif
+  return this->read(HEADSIZE+FILEINFOSIZE*index, buf, len);
+}
+
+////////////////////////////////////////////////////
+// ファイル管理テーブルの書込み(キャッシュにも反映)
+// 内容が変わらない場合は書き込まない
+// 引数
+//  index : テーブル番号
+//  buf   : 書込みデータ格納アドレス(16バイト)
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::writeEntry(uint8_t index, uint8_t* buf) {
+  uint8_t rc;
+
+#if TI2CEEPROM_CACHENUM > 0
+  if (index < TI2CEEPROM_CACHENUM && !memcmp(_tbl[index], buf, FILEINFOSIZE))
+    return 0;
+#endif
+  if ( (rc = this->update(HEADSIZE+FILEINFOSIZE*index, buf, FILEINFOSIZE)) ) {
+    _flgCache = 0;  // 書込み結果が不明のため、キャッシュを無効にする
+    return rc;
+  }
+#if TI2CEEPROM_CACHENUM > 0
+  if (index < TI2CEEPROM_CACHENUM)
+    memcpy(_tbl[index], buf, FILEINFOSIZE);
+#endif
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// ブロック割当て表の先頭アドレス
+////////////////////////////////////////////////////
+uint32_t TI2CEEPROM::fatAddr() {
+  return HEADSIZE + FILEINFOSIZE * (uint16_t)_head[POS_RCDNUM];
+}
+
+////////////////////////////////////////////////////
+// ブロックの先頭アドレス
+// 引数
+//  blk : ブロック番号(1～)
+////////////////////////////////////////////////////
+uint32_t TI2CEEPROM::blkAddr(uint8_t blk) {
+  uint32_t top;
+  memcpy(&top, _head+POS_DATATOP, sizeof(top));
+  return top + ((uint32_t)(blk-1) << BSHIFT);
+}
+
+////////////////////////////////////////////////////
+// ブロック割当て表の参照
+// (I2Cデバイスエラーの場合は_ioerrを設定し、予約ブロックとして扱う)
+// 引数
+//  blk : ブロック番号(1～)
+// 戻り値
+//  次のブロック番号、FAT_FREE:空き、FAT_END:最終ブロック
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::getFat(uint8_t blk) {
+#if TI2CEEPROM_CACHENUM > 0
+  return _fat[blk-1];
+#else
+  uint8_t v;
+  if (this->read(fatAddr()+blk-1, &v, 1)) {
+    _ioerr = 1;
+    v = FAT_RSV;
+  }
+  return v;
+#endif
+}
+
+////////////////////////////////////////////////////
+// ブロック割当て表の設定
+// (キャッシュ有効時はflushFat()でEEPROMに書き込む)
+// 引数
+//  blk  : ブロック番号(1～)
+//  next : 次のブロック番号、FAT_FREE:空き、FAT_END:最終ブロック
+////////////////////////////////////////////////////
+void TI2CEEPROM::setFat(uint8_t blk, uint8_t next) {
+#if TI2CEEPROM_CACHENUM > 0
+  if (_fat[blk-1] != next) {
+    _fat[blk-1] = next;
+    if (blk-1 < _fatlo) _fatlo = blk-1;
+    if (blk-1 > _fathi) _fathi = blk-1;
+  }
+#else
+  if (this->update(fatAddr()+blk-1, &next, 1))
+    _ioerr = 1;
+#endif
+}
+
+////////////////////////////////////////////////////
+// ブロック割当て表の変更範囲の書込み
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::flushFat() {
+#if TI2CEEPROM_CACHENUM > 0
+  uint8_t rc;
+  if (_fatlo <= _fathi) {
+    if ( (rc = this->update(fatAddr()+_fatlo, _fat+_fatlo, _fathi-_fatlo+1)) ) {
+      _flgCache = 0;
+      return rc;
+    }
+    _fatlo = 0xff;
+    _fathi = 0;
+  }
+#endif
+  return _ioerr;
+}
+
+////////////////////////////////////////////////////
+// 空きブロック数の取得
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::countFree() {
+  uint8_t cnt = 0;
+  for (uint8_t b = 1; b <= NBLK; b++)
+    if (getFat(b) == FAT_FREE)
+      cnt++;
+  return cnt;
+}
+
+////////////////////////////////////////////////////
+// ブロックの割当て
+// 連続した空きブロックを優先し、なければ前方の空きブロックから順に割り当てる
+// (事前に空きブロック数を確認していること)
+// 引数
+//  num : 割り当てるブロック数(1～)
+// 戻り値
+//  先頭ブロック番号
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::alloc(uint8_t num) {
+  uint8_t b, top = 0, run = 0, prev = 0;
+
+  // 連続した空きブロックの検索
+  for (b = 1; b <= NBLK && run < num; b++) {
+    if (getFat(b) == FAT_FREE) {
+      if (!run++)
+        top = b;
+    } else {
+      run = 0;
+    }
+  }
+  if (run < num) {
+    // 見つからない場合は、先頭の空きブロックから割り当てる
+    for (top = 1; top <= NBLK && getFat(top) != FAT_FREE; top++);
+  }
+
+  // ブロックの連結
+  for (b = top; num; b++) {
+    if (getFat(b) == FAT_FREE) {
+      if (prev)
+        setFat(prev, b);
+      prev = b;
+      num--;
+    }
+  }
+  setFat(prev, FAT_END);
+  return top;
+}
+
+////////////////////////////////////////////////////
+// ブロックの解放
+// 引数
+//  blk : 先頭ブロック番号
+////////////////////////////////////////////////////
+void TI2CEEPROM::freeChain(uint8_t blk) {
+  uint8_t next;
+  for (uint8_t i = 0; ISBLK(blk) && i < NBLK; i++) {
+    next = getFat(blk);
+    setFat(blk, FAT_FREE);
+    blk = next;
+  }
+}
+
+////////////////////////////////////////////////////
+// ファイル内データの読み書き
+// 引数
+//  blk      : ファイルの先頭ブロック番号
+//  pos      : ファイル内位置(先頭のファイル長を含む)
+//  ptr      : データ格納アドレス
+//  len      : データ長
+//  flgWrite : 0:読込み 1:書込み
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー、5:ブロック割当て表の異常
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::access(uint8_t blk, uint32_t pos, uint8_t* ptr, uint16_t len, uint8_t flgWrite) {
+  uint8_t  rc;
+  uint16_t bsize = 1 << BSHIFT;
+  uint16_t n;
+
+  // 開始位置のブロックまで移動
+  while (pos >= bsize) {
+    blk = getFat(blk);
+    if ( !ISBLK(blk) )
+      return 5;
+    pos -= bsize;
+  }
+
+  for (;;) {
+    n = bsize - pos;
+    if (n > len) n = len;
+    rc = flgWrite ? this->update(blkAddr(blk)+pos, ptr, n) : this->read(blkAddr(blk)+pos, ptr, n);
+    if (rc)
+      return rc;
+    ptr += n; len -= n;
+    if (!len)
+      break;
+    blk = getFat(blk);
+    if ( !ISBLK(blk) )
+      return 5;
+    pos = 0;
+  }
+  return 0;
 }
 
 /////////////////////////////////////////////////////
@@ -125,33 +490,71 @@ TI2CEEPROM::TI2CEEPROM(uint8_t addr) {
 //  sign     : シグニチャ(4バイト文字列)
 //  devName  : デバイス名(10バイト文字列)
 //  numtable : テーブル数（ファイル保存可能数)
-//  fsize    : 1ファイルの最大ファイルサイズ
-// 戻り値
-//  0: 正常終了, 1～4:I2Cデバイスエラー 
-////////////////////////////////////////////////////
-uint8_t TI2CEEPROM::format(uint8_t* sign, uint8_t* devName, uint8_t numtable, uint16_t fsize) {
- uint8_t rc;
- uint16_t blksz = fsize / 256;                       // 最大ファイルサイズ
-
- // ヘッダーの書込み
- if ( (rc = this->write(POS_SIGN, sign, SZ_SIGN)) )                    // シグニチャの書込み
-   return rc;
- if ( (rc = this->write(POS_VOLUME, devName, SZ_VOLUME)) )             // デバイス名の書込み
-   return rc;
- if ( (rc = this->write(POS_RCDNUM, (uint8_t*)&numtable, SZ_RCDNUM)) ) // テーブル数の書込み
-   return rc;
- if ( (rc = this->write(POS_BSIZE, (uint8_t*)&blksz, SZ_BSIZE)) )      // ブロックサイズの書込み
-   return rc;
- 
-  // テーブルの初期化
-  uint8_t table[FILEINFOSIZE];
-  memset(table, 0, FILEINFOSIZE);
-  uint16_t addr = FILEINFOSIZE;
-  for (uint16_t i = 0; i < numtable; i++) {
-    if ( (rc = this->write(addr, table, FILEINFOSIZE)) )  // テーブルの書込み
+//  devsize  : EEPROM容量(kバイト、4～256)
+//  asel     : ブロック選択ビット位置(64kバイトを超える場合のみ利用)
+// 戻り値
+//  0: 正常終了, 1～4:I2Cデバイスエラー, 5:容量不足
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::format(uint8_t* sign, uint8_t* devName, uint8_t numtable, uint16_t devsize, uint8_t asel) {
+  uint8_t  rc;
+  uint8_t  shift;
+  uint32_t dsize = (uint32_t)devsize << 10;
+  uint32_t fat   = HEADSIZE + FILEINFOSIZE * (uint16_t)numtable;
+  uint32_t top, nblk = 0;
+
+  _flgCache = 0;                                      // キャッシュ無効
+  if (fat >= dsize)
+    return 5;
+
+  // ブロック数が上限以下となる最小のブロックサイズを求める
+  for (shift = BSHIFT_MIN; shift <= BSHIFT_MAX; shift++) {
+    nblk = (dsize - fat) >> shift;
+    if (nblk > TI2CEEPROM_NBLKMAX)
+      nblk = TI2CEEPROM_NBLKMAX;
+    top  = (fat + nblk + (1UL << shift) - 1) & ~((1UL << shift) - 1); // データ領域先頭(ブロック境界)
+    nblk = (dsize > top) ? (dsize - top) >> shift : 0;
+    if (nblk <= TI2CEEPROM_NBLKMAX)
+      break;
+  }
+  if (!nblk || shift > BSHIFT_MAX)
+    return 5;
+
+  // ヘッダーの作成
+  memset(_head, 0, HEADSIZE);
+  memcpy(_head+POS_SIGN, sign, SZ_SIGN);
+  strncpy((char*)_head+POS_VOLUME, (char*)devName, SZ_VOLUME);
+  _head[POS_RCDNUM] = numtable;
+  _head[POS_FORMAT] = FORMAT_ID;
+  _head[POS_BSHIFT] = shift;
+  _head[POS_NBLK]   = nblk;
+  _head[POS_ASEL]   = asel;
+  _head[POS_PGSIZE] = _pgsize;
+  memcpy(_head+POS_DATATOP, &top, sizeof(top));
+  _asel = asel;
+
+  // ファイル管理テーブル、ブロック割当て表の初期化
+  uint8_t  zero[FILEINFOSIZE];
+  uint16_t n;
+  memset(zero, 0, FILEINFOSIZE);
+  for (uint32_t addr = HEADSIZE; addr < fat + nblk; addr += n) {
+    n = fat + nblk - addr;
+    if (n > FILEINFOSIZE) n = FILEINFOSIZE;
+    if ( (rc = this->write(addr, zero, n)) )
       return rc;
-    addr+= FILEINFOSIZE;
   }
+
+  // ヘッダーの書込み(最後に書き込み、途中で中断した場合は未フォーマットとする)
+  if ( (rc = this->write(0, _head, HEADSIZE)) )
+    return rc;
+
+  // 書込み内容をキャッシュに反映
+#if TI2CEEPROM_CACHENUM > 0
+  memset(_tbl, 0, sizeof(_tbl));
+  memset(_fat, 0, sizeof(_fat));
+  _fatlo = 0xff;
+  _fathi = 0;
+#endif
+  _flgCache = 1;
   return 0;
 }
 
@@ -164,7 +567,7 @@ uint8_t TI2CEEPROM::format(uint8_t* sign, uint8_t* devName, uint8_t numtable, ui
 //   1: I2Cデバイスエラー
 //   2: シグニチャ不一致
 ////////////////////////////////////////////////////
-uint8_t TI2CEEPROM::checkSign(uint8_t* sign) {  
+uint8_t TI2CEEPROM::checkSign(uint8_t* sign) {
   uint8_t rdSign[SZ_SIGN+1];
   memset(rdSign, 0, SZ_SIGN+1);
 
@@ -173,40 +576,57 @@ uint8_t TI2CEEPROM::checkSign(uint8_t* sign) {
     return 1;
   }
 
- // シグニチャの比較
- return strncmp((char*)sign, (char*)rdSign, SZ_SIGN) ? 2:0;
+ // シグニチャの比較(不一致の場合は別のEEPROMに交換された可能性があるためキャッシュを無効にする)
+ if (strncmp((char*)sign, (char*)rdSign, SZ_SIGN)) {
+   _flgCache = 0;
+   return 2;
+ }
+ return 0;
 }
 
 ////////////////////////////////////////////////////
-// ファイル保存サイズの取得
+// テーブル数の取得
 // (事前にシグニチャチェックを行っていること)
 // 戻り値
 //  -1  : デバイスエラー
 //  0～ : テーブル数
 ////////////////////////////////////////////////////
 int16_t TI2CEEPROM::maxFiles() {
-  uint8_t rc;
   // テーブル数の読み込み
-  if (this->read(POS_RCDNUM, &rc, SZ_RCDNUM)) {
+  if (this->loadCache()) {
     return -1;
   }
-  return (int16_t)rc;     
+  return (int16_t)_head[POS_RCDNUM];
 }
 
 ////////////////////////////////////////////////////
-// 最大ファイルサイズ(ページサイズ)の取得
+// ブロックサイズの取得
 // (事前にシグニチャチェックを行っていること)
 // 戻り値
 //  -1  : デバイスエラー
-//  0～ : ファイルサイズ
+//  0～ : ブロックサイズ
 ////////////////////////////////////////////////////
-int16_t TI2CEEPROM::pageSize() {
-  uint8_t rc;
-  // 最大ファイルサイズ(ページサイズ)の読み込み
-  if (this->read(POS_BSIZE, &rc, SZ_BSIZE)) {
+int16_t TI2CEEPROM::blockSize() {
+  if (this->loadCache()) {
+    return -1;
+  }
+  return 1 << BSHIFT;
+}
+
+////////////////////////////////////////////////////
+// 空き容量の取得(空きブロック数xブロックサイズ)
+// 戻り値
+//  -1  : デバイスエラー
+//  0～ : 空き容量(バイト)
+////////////////////////////////////////////////////
+int32_t TI2CEEPROM::freeSize() {
+  int32_t sz;
+  _ioerr = 0;
+  if (this->loadCache()) {
     return -1;
   }
-  return ((int16_t)rc)*256;     
+  sz = (int32_t)countFree() << BSHIFT;
+  return _ioerr ? -1 : sz;
 }
 
 ////////////////////////////////////////////////////
@@ -219,16 +639,16 @@ int16_t TI2CEEPROM::pageSize() {
 int16_t TI2CEEPROM::countFiles() {
   int16_t  num;
   uint8_t  flg;
-  
+
   // テーブル数の取得
   if ( (num = this->maxFiles()) < 0 )
-    return -1;   
-  
+    return -1;
+
   // 保存ファイル数のカウント
   int16_t cnt = 0;
   for (int16_t i=0; i < num; i++) {
     // ファイル状態のの読み込み
-    if (this->read(HEADSIZE+FILEINFOSIZE*i, &flg, 1)) {
+    if (this->readEntry(i, &flg, 1)) {
       return -1;
     }
     if (flg)
@@ -243,12 +663,13 @@ int16_t TI2CEEPROM::countFiles() {
 // 引数
 //  devname : 取得したデバイス名の格納アドレス
 // 戻り値
-//  0:正常終了 ,1～4:I2Cデバイス異常
+//  0:正常終了 ,1～5:I2Cデバイス異常
 ////////////////////////////////////////////////////
 uint8_t TI2CEEPROM::getDevName(uint8_t* devname) {
   uint8_t rc;
   memset(devname,0,SZ_VOLUME+1);
-  rc =this->read(POS_VOLUME, devname, SZ_VOLUME);
+  if ( !(rc = this->loadCache()) )
+    memcpy(devname, _head+POS_VOLUME, SZ_VOLUME);
   return  rc;
 }
 
@@ -264,15 +685,15 @@ uint8_t TI2CEEPROM::getDevName(uint8_t* devname) {
 int16_t TI2CEEPROM::find(uint8_t* fname) {
   int16_t  num, rc = -2;
   uint8_t  table[FILEINFOSIZE];
-  
+
   // テーブル数の取得
   if ((num = this->maxFiles()) < 0)
     return -1;
-  
+
   // テーブルの逐次比較
   for (int16_t i=0; i < num; i++) {
     // ファイル状態のの読み込み
-    if (this->read(HEADSIZE+FILEINFOSIZE*i, table, FILEINFOSIZE)) {
+    if (this->readEntry(i, table, FILEINFOSIZE)) {
       return -1;
     }
     if (strncmp((char*)fname, (char*)table, SZ_FNAME) == 0) {
@@ -280,7 +701,7 @@ int16_t TI2CEEPROM::find(uint8_t* fname) {
        break;
     }
   }
-  return rc;                  
+  return rc;
 }
 
 ////////////////////////////////////////////////////
@@ -292,16 +713,16 @@ int16_t TI2CEEPROM::find(uint8_t* fname) {
 int16_t TI2CEEPROM::findEmpty() {
   int16_t  num, rc = -2;
   uint8_t  table_top;
-  
-  
+
+
   // テーブル数の取得
   if ((num = this->maxFiles()) < 0 )
     return -1;
-  
+
   // テーブルの逐次比較
   for (int16_t i=0; i < num; i++) {
     // ファイル状態のの読み込み
-    if (this->read(HEADSIZE + FILEINFOSIZE*i, &table_top, 1)) {
+    if (this->readEntry(i, &table_top, 1)) {
       return -1;
     }
     if (table_top == 0) {
@@ -312,8 +733,32 @@ int16_t TI2CEEPROM::findEmpty() {
   return rc;
 }
 
+////////////////////////////////////////////////////
+// ファイルサイズの取得
+// 引数
+//  fname : ファイル名
+// 戻り値
+//  -1  : デバイスエラー
+//  -2  : 該当ファイルなし
+//  0～ : ファイルサイズ(バイト)
+////////////////////////////////////////////////////
+int32_t TI2CEEPROM::fileSize(uint8_t* fname) {
+  int16_t  index;
+  uint8_t  table[FILEINFOSIZE];
+  uint32_t flen;
+
+  if ((index = this->find(fname)) < 0)
+    return index;
+  if (this->readEntry(index, table, FILEINFOSIZE) || !ISBLK(table[POS_FBLK]))
+    return -1;
+  if (this->read(blkAddr(table[POS_FBLK]), (uint8_t*)&flen, FHEADSIZE))
+    return -1;
+  return flen;
+}
+
 ////////////////////////////////////////////////////
 // データのロード
+// (ファイルサイズを超える部分は読み込まない)
 // 引数
 //  fname : ファイル名
 //  pos   : ファイル内データ読込位置
@@ -324,56 +769,96 @@ int16_t TI2CEEPROM::findEmpty() {
 //   1: I2Cデバイスエラー
 //   2: 該当ファイルなし
 ////////////////////////////////////////////////////
-uint8_t TI2CEEPROM::load(uint8_t* fname, uint8_t* pos, uint8_t*ptr, uint16_t len) {
-  int32_t index;
-  int16_t  num, pageSize;  
-
-  // テーブル数の取得
-  if ((num = this->maxFiles()) < 0 )
-    return 1;
-
-  // ページサイズの取得
-  if ( (pageSize = this->pageSize()) < 0 )
-    return 1;
+uint8_t TI2CEEPROM::load(uint8_t* fname, uint16_t pos, uint8_t*ptr, uint16_t len) {
+  int32_t  flen;
+  int16_t  index;
+  uint8_t  table[FILEINFOSIZE];
 
-  if ((index = this->find(fname)) < 0) {
-    if (index == -1) {
+  _ioerr = 0;
+  if ((flen = this->fileSize(fname)) < 0) {
+    if (flen == -1) {
       return 1; // I2Cデバイスエラー
     } else {
       return 2; // 該当ファイルなし
     }
   }
-  
-  if (this->read(HEADSIZE + FILEINFOSIZE * num + pageSize * index + (uint16_t)pos, ptr, len)) {
+  if (pos >= flen)
+    return 0;
+  if (pos + len > flen)
+    len = flen - pos;
+
+  index = this->find(fname);
+  if (this->readEntry(index, table, FILEINFOSIZE))
+    return 1;
+  if (this->access(table[POS_FBLK], FHEADSIZE + pos, ptr, len, 0) || _ioerr) {
      return 1;
   }
   return 0;
 }
 
+////////////////////////////////////////////////////
+// 保存データとブロックの内容の比較
+// 引数
+//  blk  : ブロック番号
+//  pos  : ブロック先頭のファイル内位置(先頭のファイル長を含む)
+//  head : 前置データ
+//  hlen : 前置データ長
+//  ptr  : データ格納アドレス
+//  len  : データ長
+// 戻り値
+//  0: 一致、1:不一致またはI2Cデバイスエラー
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::cmpBlk(uint8_t blk, uint32_t pos, const uint8_t* head, uint8_t hlen, const uint8_t* ptr, uint16_t len) {
+  uint8_t  buf[CP_BLKSIZE];
+  uint8_t  c;
+  uint32_t flen = (uint32_t)len + hlen;
+  uint32_t end  = flen + FHEADSIZE;
+  uint32_t p;
+
+  for (uint16_t i = 0; i < (1 << BSHIFT) && pos + i < end; i += CP_BLKSIZE) {
+    if (this->read(blkAddr(blk)+i, buf, CP_BLKSIZE))
+      return 1;
+    for (uint8_t j = 0; j < CP_BLKSIZE && (p = pos + i + j) < end; j++) {
+      if (p < FHEADSIZE)
+        c = ((uint8_t*)&flen)[p];
+      else if (p < FHEADSIZE + hlen)
+        c = head[p - FHEADSIZE];
+      else
+        c = ptr[p - FHEADSIZE - hlen];
+      if (buf[j] != c)
+        return 1;
+    }
+  }
+  return 0;
+}
+
 ////////////////////////////////////////////////
 // データの保存
+// 新しいブロックに書き込んでから管理テーブルを切り替え、旧ブロックを解放する
+// 既存ファイルのファイル長が同じ場合は、末尾から内容が一致するブロックをそのまま再利用する
+// (書込み中に電源断した場合は旧データが残る、未解放のブロックは詰め直しで解放される)
+// 書込みは内容が異なる部分のみ行う
 // 引数
 //  fname : ファイル名
-//  pos   : ファイル内データ書込み位置
 //  ptr   : データ格納アドレス
 //  len   : データ長
 //  ftype : ファイルタイプ(0:ブランク, 1:プログラム(デフォルト), 2:データ)
+//  head  : 前置データ(データの前に続けて保存する、NULL:なし)
+//  hlen  : 前置データ長
 // 戻り値
 //   0: 正常
 //   1: I2Cデバイスエラー
 //   2: 保存領域無し
 ////////////////////////////////////////////////
-uint8_t TI2CEEPROM::save(uint8_t* fname, uint8_t* pos, uint8_t*ptr, uint16_t len, uint8_t ftyple) {
-  int32_t  index;
-  int16_t  num, pageSize;
-
-  // テーブル数の取得
-  if ( (num = this->maxFiles()) < 0 )
-    return 1;
+uint8_t TI2CEEPROM::save(uint8_t* fname, uint8_t*ptr, uint16_t len, uint8_t ftyple, const uint8_t* head, uint8_t hlen) {
+  int16_t  index;
+  uint8_t  table[FILEINFOSIZE];
+  uint8_t  top = 0, ntop, need, cnt = 0, b, next;
+  uint8_t  keep = 0, nkeep = 0;  // 再利用する末尾のブロックの先頭、その位置(ブロック数)
+  uint32_t flen = (uint32_t)len + hlen;
+  uint32_t olen;
 
-  // ページサイズの取得
-  if ( (pageSize = this->pageSize()) < 0 )
-    return 1;
+  _ioerr = 0;
 
   // 既存ファイルのチェック
   if ((index = this->find(fname)) < 0) {
@@ -389,21 +874,76 @@ uint8_t TI2CEEPROM::save(uint8_t* fname, uint8_t* pos, uint8_t*ptr, uint16_t len
         }
       }
     }
+  } else {
+    if (this->readEntry(index, table, FILEINFOSIZE))
+      return 1;
+    top = table[POS_FBLK];
+    for (b = top; ISBLK(b) && cnt < NBLK; b = getFat(b))
+      cnt++;
+  }
+
+  // 必要ブロック数の確認
+  if ( ((flen + FHEADSIZE + (1 << BSHIFT) - 1) >> BSHIFT) > NBLK )
+    return 2;
+  need  = (flen + FHEADSIZE + (1 << BSHIFT) - 1) >> BSHIFT;
+
+  // 再利用するブロックの確認
+  // (ファイル長が同じ場合のみ、ブロックの連結が変わらない末尾の一致部分とする)
+  if (cnt == need && !this->access(top, 0, (uint8_t*)&olen, FHEADSIZE, 0) && olen == flen) {
+    b = top;
+    for (uint8_t i = 0; i < cnt; i++, b = getFat(b)) {
+      if (this->cmpBlk(b, (uint32_t)i << BSHIFT, head, hlen, ptr, len)) {
+        keep = 0;
+      } else if (!keep) {
+        keep  = b;
+        nkeep = i;
+      }
+    }
   }
+  if (_ioerr)
+    return 1;
+  if (!keep)
+    nkeep = need;
+  if (nkeep && countFree() < nkeep)
+    return 2;
 
-  // データの保存
-  if (this->write(HEADSIZE + FILEINFOSIZE * num + pageSize * index + (uint16_t)pos, ptr, len)) {
+  // 新しいブロックの確保(再利用するブロックに連結する)
+  if (nkeep) {
+    ntop = alloc(nkeep);
+    if (keep) {
+      b = ntop;
+      for (uint8_t i = 1; i < nkeep; i++)
+        b = getFat(b);
+      setFat(b, keep);
+    }
+  } else {
+    ntop = keep;
+  }
+
+  // データの書込み(内容が異なる部分のみ)
+  if (this->access(ntop, 0, (uint8_t*)&flen, FHEADSIZE, 1) ||
+      this->access(ntop, FHEADSIZE, (uint8_t*)head, hlen, 1) ||
+      this->access(ntop, FHEADSIZE + hlen, ptr, len, 1) ||
+      this->flushFat() ) {
      return 1;
   }
 
-  // テーブルの更新
-  uint8_t tmp[FILEINFOSIZE];
-  memset(tmp,0,FILEINFOSIZE);
-  strcpy((char *)tmp,(char *)fname);        // ファイル名
-  tmp[POS_FTYPE] = ftyple;                  // ファイル種別
-  if (this->write(HEADSIZE + FILEINFOSIZE * index, tmp, 16)) {
+  // テーブルの更新(内容が変わらない場合は書き込まない)
+  memset(table,0,FILEINFOSIZE);
+  strncpy((char *)table,(char *)fname, SZ_FNAME); // ファイル名
+  table[POS_FTYPE] = ftyple;                      // ファイル種別
+  table[POS_FBLK]  = ntop;                        // 先頭ブロック番号
+  if (this->writeEntry(index, table)) {
      return 1;
   }
+
+  // 旧ブロックの解放(再利用したブロックは除く)
+  for (b = top; cnt && ISBLK(b) && b != keep; b = next, cnt--) {
+    next = getFat(b);
+    setFat(b, FAT_FREE);
+  }
+  if (this->flushFat())
+    return 1;
   return 0;
 }
 
@@ -417,14 +957,11 @@ uint8_t TI2CEEPROM::save(uint8_t* fname, uint8_t* pos, uint8_t*ptr, uint16_t len
 //   2: 該当ファイルなし
 ////////////////////////////////////////////////////
 uint8_t TI2CEEPROM::del(uint8_t* fname) {
-  int32_t index;
-  int16_t  num;  
+  int16_t  index;
   uint8_t  table[FILEINFOSIZE];
-  
-  // テーブル数の取得
-  if ((num = this->maxFiles()) < 0 )
-    return 1;
-    
+  uint8_t  blk;
+
+  _ioerr = 0;
   if ((index = this->find(fname)) < 0) {
     if (index == -1) {
       return 1; // I2Cデバイスエラー
@@ -432,13 +969,122 @@ uint8_t TI2CEEPROM::del(uint8_t* fname) {
       return 2; // 該当ファイルなし
     }
   }
+  if (this->readEntry(index, table, FILEINFOSIZE))
+    return 1;
+  blk = table[POS_FBLK];
 
   // 該当ファイルの削除
   memset(table,0,FILEINFOSIZE);
-  if (this->write(HEADSIZE+FILEINFOSIZE*index, table, FILEINFOSIZE)) {
+  if (this->writeEntry(index, table)) {
      return 1;
   }
-  return 0;  
+  freeChain(blk);
+  if (this->flushFat())
+    return 1;
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// ブロックの入れ替え
+// ブロックxとdの内容を入れ替え、ブロック割当て表と管理テーブルの参照も入れ替える
+// 引数
+//  x : 使用中のブロック番号
+//  d : 入れ替え先のブロック番号(空きブロックでも可)
+// 戻り値
+//  0: 正常終了、1～4:I2Cデバイスエラー
+////////////////////////////////////////////////////
+#define SWAPBLK(v) ((v) == x ? d : ((v) == d ? x : (v)))
+uint8_t TI2CEEPROM::swapBlk(uint8_t x, uint8_t d) {
+  uint8_t  bx[CP_BLKSIZE], bd[CP_BLKSIZE];
+  uint8_t  table[FILEINFOSIZE];
+  uint8_t  fx = getFat(x), fd = getFat(d);
+  uint8_t  rc;
+  uint32_t ax = blkAddr(x), ad = blkAddr(d);
+
+  // データの入れ替え(入れ替え先が空きの場合は複写のみ)
+  for (uint16_t pos = 0; pos < (1 << BSHIFT); pos += CP_BLKSIZE) {
+    if ( (rc = this->read(ax+pos, bx, CP_BLKSIZE)) )
+      return rc;
+    if (fd != FAT_FREE) {
+      if ( (rc = this->read(ad+pos, bd, CP_BLKSIZE)) || (rc = this->update(ax+pos, bd, CP_BLKSIZE)) )
+        return rc;
+    }
+    if ( (rc = this->update(ad+pos, bx, CP_BLKSIZE)) )
+      return rc;
+  }
+
+  // ブロック割当て表の参照の入れ替え
+  for (uint8_t b = 1; b <= NBLK; b++) {
+    uint8_t v = getFat(b);
+    if (b != x && b != d && (v == x || v == d))
+      setFat(b, SWAPBLK(v));
+  }
+  setFat(d, SWAPBLK(fx));
+  setFat(x, SWAPBLK(fd));
+
+  // 管理テーブルの参照の入れ替え
+  for (uint8_t i = 0; i < _head[POS_RCDNUM]; i++) {
+    if ( (rc = this->readEntry(i, table, FILEINFOSIZE)) )
+      return rc;
+    if (table[0] && (table[POS_FBLK] == x || table[POS_FBLK] == d)) {
+      table[POS_FBLK] = SWAPBLK(table[POS_FBLK]);
+      if ( (rc = this->writeEntry(i, table)) )
+        return rc;
+    }
+  }
+  return _ioerr;
+}
+
+////////////////////////////////////////////////////
+// 詰め直し
+// 管理テーブルの順に各ファイルのブロックを先頭から連続して並べ直し、空きブロックを末尾にまとめる
+// 管理テーブルから参照されていないブロック(保存中断等による未解放ブロック)は解放する
+// ※処理中に電源断した場合はファイルが破損することがある
+// 戻り値
+//  0: 正常終了、1:I2Cデバイスエラー
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::compact() {
+  uint8_t  table[FILEINFOSIZE];
+  uint8_t  used[(TI2CEEPROM_NBLKMAX+8)/8];
+  uint8_t  b, n, target = 1;
+
+  _ioerr = 0;
+  if (this->loadCache())
+    return 1;
+
+  // 参照されているブロックの確認
+  memset(used, 0, sizeof(used));
+  for (uint8_t i = 0; i < _head[POS_RCDNUM]; i++) {
+    if (this->readEntry(i, table, FILEINFOSIZE))
+      return 1;
+    if (!table[0])
+      continue;
+    for (b = table[POS_FBLK], n = 0; ISBLK(b) && n < NBLK; b = getFat(b), n++)
+      used[b>>3] |= 1 << (b & 7);
+  }
+
+  // 未参照ブロックの解放
+  for (b = 1; b <= NBLK; b++)
+    if ( !(used[b>>3] & (1 << (b & 7))) && getFat(b) != FAT_FREE )
+      setFat(b, FAT_FREE);
+
+  // ファイル毎にブロックを先頭から並べる
+  for (uint8_t i = 0; i < _head[POS_RCDNUM]; i++) {
+    if (this->readEntry(i, table, FILEINFOSIZE))
+      return 1;
+    if (!table[0])
+      continue;
+    for (b = table[POS_FBLK]; ISBLK(b) && target <= NBLK; b = getFat(b), target++) {
+      if (b != target) {
+        if (this->swapBlk(b, target))
+          return 1;
+        b = target;
+      }
+    }
+  }
+  if (this->flushFat())
+    return 1;
+  return 0;
 }
 
 ////////////////////////////////////////////////////
@@ -450,7 +1096,6 @@ uint8_t TI2CEEPROM::del(uint8_t* fname) {
 ////////////////////////////////////////////////////
 uint8_t TI2CEEPROM::getTable(uint8_t* table, uint8_t index) {
   int16_t  num;
-  uint16_t adr = HEADSIZE+FILEINFOSIZE*index;
 
     // テーブル数の取得
   if ((num = this->maxFiles()) < 0 )
@@ -459,10 +1104,206 @@ uint8_t TI2CEEPROM::getTable(uint8_t* table, uint8_t index) {
   if (index >= num) {
     return 2;
   }
-  
-  if (this->read(adr, table, FILEINFOSIZE)) {
+
+  if (this->readEntry(index, table, FILEINFOSIZE)) {
+    return 1;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// データファイルのオープン
+// 追記指定時、該当ファイルがない場合は新規に作成する
+// オープン時にファイル長とブロックの連結を照合し、電源断等で残った
+// ファイル長を超える余分なブロックは解放する(回復処理)
+// 読込みのみの場合は書込みを行わず、ファイル長を辿れた範囲に切り詰めて扱うのみとする
+// 引数
+//  f         : ファイル情報
+//  fname     : ファイル名
+//  flgAppend : 0:読込みのみ 1:追記
+//  ftype     : 追記時のファイル種別(新規作成時の種別)
+// 戻り値
+//   0: 正常
+//   1: I2Cデバイスエラー
+//   2: 該当ファイルなし
+//   3: 保存領域無し
+//   4: ファイル種別が異なる(追記時)
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::open(ti2ceeprom_file_t* f, uint8_t* fname, uint8_t flgAppend, uint8_t ftype) {
+  int16_t  index;
+  uint8_t  table[FILEINFOSIZE];
+  uint8_t  blk, next, cnt;
+  uint32_t need;
+
+  f->index = TI2CEEPROM_FCLOSED;
+  _ioerr = 0;
+  if ((index = this->find(fname)) == -2 && flgAppend) {
+    // 空のデータファイルを作成する
+    switch (this->save(fname, table, 0, ftype)) {
+      case 0:  break;
+      case 2:  return 3;
+      default: return 1;
+    }
+    index = this->find(fname);
+  }
+  if (index < 0)
+    return (index == -1) ? 1 : 2;
+  if (this->readEntry(index, table, FILEINFOSIZE) || !ISBLK(table[POS_FBLK]))
+    return 1;
+  if (flgAppend && table[POS_FTYPE] != ftype)
+    return 4;
+  f->top = table[POS_FBLK];
+  if (this->read(blkAddr(f->top), (uint8_t*)&f->len, FHEADSIZE))
+    return 1;
+
+  // ファイル長に必要なブロックまで辿る
+  if (f->len > ((uint32_t)NBLK << BSHIFT))
+    need = (uint32_t)NBLK + 1;  // ファイル長の異常(辿れた範囲に切り詰める)
+  else
+    need = (f->len + FHEADSIZE + (1 << BSHIFT) - 1) >> BSHIFT;
+  for (blk = f->top, cnt = 1; cnt < need && cnt < NBLK; cnt++) {
+    next = getFat(blk);
+    if (!ISBLK(next))
+      break;
+    blk = next;
+  }
+  if (_ioerr)
+    return 1;
+  if (cnt < need) {
+    // ブロックが不足する場合は、ファイル長を辿れた範囲に切り詰める
+    f->len = ((uint32_t)cnt << BSHIFT) - FHEADSIZE;
+    if (flgAppend && this->write(blkAddr(f->top), (uint8_t*)&f->len, FHEADSIZE))
+      return 1;
+  } else if (flgAppend && getFat(blk) != FAT_END) {
+    // 余分なブロックを解放する
+    freeChain(getFat(blk));
+    setFat(blk, FAT_END);
+    if (this->flushFat())
+      return 1;
+  }
+  f->blk   = blk;
+  f->n     = 0;
+  f->mode  = flgAppend;
+  f->index = index;
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// 書込みバッファの書込み
+// ブロック末尾に達している場合は、新しいブロックを割り当てて連結する
+// データを書き込んだ後にファイル長を更新する
+// 引数
+//  f : ファイル情報
+// 戻り値
+//   0: 正常
+//   1: I2Cデバイスエラー
+//   3: 保存領域無し
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::writeBuf(ti2ceeprom_file_t* f) {
+  uint16_t off = (f->len + FHEADSIZE) & ((1 << BSHIFT) - 1);
+  uint32_t len = f->len + f->n;
+  uint8_t  blk;
+
+  if (!f->n)
+    return 0;
+  _ioerr = 0;
+  if (!off) {
+    // 新しいブロックの割当て
+    if (!countFree())
+      return 3;
+    blk = alloc(1);
+    setFat(f->blk, blk);
+    if (this->flushFat())
+      return 1;
+    f->blk = blk;
+  }
+  if (this->write(blkAddr(f->blk) + off, f->buf, f->n) ||
+      this->write(blkAddr(f->top), (uint8_t*)&len, FHEADSIZE) )
     return 1;
+  f->len = len;
+  f->n   = 0;
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// データファイルへの追記
+// 書込みバッファに蓄積し、EEPROMの書込み単位(ページ境界、Wireの送信バッファサイズ)
+// に達した時点でまとめて書き込む
+// 引数
+//  f   : ファイル情報(追記でオープン済み)
+//  ptr : データ格納アドレス
+//  len : データ長
+// 戻り値
+//   0: 正常
+//   1: I2Cデバイスエラー
+//   3: 保存領域無し(追記は行わない)
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::append(ti2ceeprom_file_t* f, uint8_t* ptr, uint16_t len) {
+  uint8_t  rc, n;
+  uint16_t off, lim;
+
+  // 末尾ブロックに収まらない場合は、空きブロックを確認する(書込み途中で領域不足としない)
+  off = (1 << BSHIFT) - ((f->len + f->n + FHEADSIZE) & ((1 << BSHIFT) - 1));
+  if (len > (off & ((1 << BSHIFT) - 1)) &&
+      len > (off & ((1 << BSHIFT) - 1)) + ((uint32_t)countFree() << BSHIFT))
+    return 3;
+
+  while (len) {
+    // 書込み単位の残りバイト数
+    off = (f->len + FHEADSIZE) & ((1 << BSHIFT) - 1);
+    lim = _pgsize - ((blkAddr(1) + off) & (_pgsize - 1));
+    if (lim > TI2CEEPROM_WBUFSIZE)
+      lim = TI2CEEPROM_WBUFSIZE;
+    n = (lim - f->n > len) ? len : lim - f->n;
+    memcpy(f->buf + f->n, ptr, n);
+    f->n += n; ptr += n; len -= n;
+    if (f->n >= lim && (rc = writeBuf(f)))
+      return rc;
   }
   return 0;
 }
 
+////////////////////////////////////////////////////
+// データファイルの読込み(書込みバッファ内の未書込みデータを含む)
+// 引数
+//  f   : ファイル情報(オープン済み)
+//  pos : ファイル内データ読込位置
+//  ptr : データ格納アドレス
+//  len : データ長
+// 戻り値
+//   0: 正常
+//   1: I2Cデバイスエラー
+//   2: ファイル長を超える
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::readData(ti2ceeprom_file_t* f, uint32_t pos, uint8_t* ptr, uint16_t len) {
+  uint16_t n = 0;
+
+  if (pos + len > f->len + f->n)
+    return 2;
+  _ioerr = 0;
+  if (pos < f->len) {
+    n = (pos + len > f->len) ? f->len - pos : len;
+    if (this->access(f->top, FHEADSIZE + pos, ptr, n, 0) || _ioerr)
+      return 1;
+  }
+  if (n < len)
+    memcpy(ptr + n, f->buf + (pos + n - f->len), len - n);
+  return 0;
+}
+
+////////////////////////////////////////////////////
+// データファイルのクローズ(書込みバッファを書き込む)
+// 引数
+//  f : ファイル情報
+// 戻り値
+//   0: 正常
+//   1: I2Cデバイスエラー
+//   3: 保存領域無し
+////////////////////////////////////////////////////
+uint8_t TI2CEEPROM::close(ti2ceeprom_file_t* f) {
+  uint8_t rc = 0;
+  if (f->index != TI2CEEPROM_FCLOSED)
+    rc = flush(f);
+  f->index = TI2CEEPROM_FCLOSED;
+  return rc;
+}
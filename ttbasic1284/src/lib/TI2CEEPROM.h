@@ -2,6 +2,15 @@
 // TI2CEEPROM I2C接続EEPROMクラス 簡易ファイルシステム
 // 作成 2018/02/25 by たま吉さん
 // 修正 2019/05/28 by たま吉さん,スペルミスTI2CEPPROMをTI2CEEPROMに修正,gccワーニング修正
+// 修正 2026/10/19 ページ単位の書込み、ACKポーリングによる書込み完了待ち、読込みの一括転送化
+// 修正 2026/10/19 ヘッダー、ファイル管理テーブルのSRAMキャッシュ対応
+// 修正 2026/10/19 ブロック割当て表による可変長ファイル、64kバイト超のEEPROM、詰め直しの対応
+// 修正 2026/10/19 比較書込み(内容が異なる部分のみ書込み)、保存時の既存ブロックの再利用
+// 修正 2026/10/19 データファイルへの追記(書込みバッファ、オープン時の回復処理)対応
+// 修正 2026/10/19 保存時の前置データ(ヘッダー)指定の追加
+// 修正 2026/10/19 データファイル以外への追記(オープン時のファイル種別指定)対応
+// 修正 2026/10/19 保存時は新しいブロックに書き込んでから切り替えるように修正(電源断対策)
+// 修正 2026/10/19 読込みのみのオープン時は回復処理の書込みを行わないように修正
 //
 
 #ifndef __TI2CEEPROM_H__
@@ -12,93 +21,168 @@
 用途としては、Tiny BASICでのプログラム、データの保存を想定しています。
 
 [仕様]
-・対応EEPROM：24系で64kバイトまでの容量
+・対応EEPROM：24系で4kバイト～256kバイトまでの容量
+  64kバイトを超える容量はI2Cスレーブアドレスのブロック選択ビットでアドレス上位を指定する
+  (ブロック選択ビット位置 24LC1025:2, 24M01・AT24CM01/02:0)
 ・簡易的なファイル管理テーブルにてファイル名を指定したファイルの保存と読み込みが可能
-・
+・データ領域を最大253個のブロックに分割し、ブロック割当て表(FAT)で可変長のファイルを管理する
+  ファイルは連続した空きブロックを優先して割り当てる
+  詰め直し(compact)により、各ファイルのブロックを連続させ、空きブロックを末尾にまとめる
+・保存は新しいブロックに書き込んでから管理テーブルを切り替え、旧ブロックを解放する
+  (書込み中に電源断した場合は旧データが残る、このため保存には旧データ分とは別の空きが必要)
+  既存ファイルのファイル長が同じ場合は、末尾から内容が一致するブロックのみ再利用する
+  書込みは読み込んで比較した結果、内容が異なる部分のみ行う
+  (ファイル管理テーブル、ブロック割当て表も同様)
+・データファイルはオープンして追記、部分読込みが可能(ログ記録用)
+  追記データはファイル情報内の書込みバッファ(SRAM)に蓄積し、書込み単位(ページ境界、
+  Wireの送信バッファサイズ)に達した時点でまとめて書き込み、その後ファイル長を更新する
+  (電源断時に失われるのはバッファ内の未書込みデータのみ、flush()で強制的に書き込む)
+  追記のオープン時にファイル長とブロックの連結を照合し、余分なブロックを解放する
+  (読込みのみのオープンでは書き込まない)
+  オープン中のファイルに対して保存、削除、詰め直しを行わないこと
+・書込みはEEPROMのページ境界で分割し、ACKポーリングで書込み完了を待つ
+  ページサイズはコンストラクタまたはsetPageSize()で指定する(24LC64:32, 24LC256:64, 24LC512:128)
+  フォーマット時のページサイズはヘッダーに記録し、以降はその値を利用する
+・ヘッダー、ファイル管理テーブル(先頭からTI2CEEPROM_CACHENUM件)とブロック割当て表を初回アクセス時に
+  SRAMに読み込み、ファイル名の検索、空きブロックの検索等はSRAM上で行う
+  テーブルの書込み時はEEPROMとキャッシュの両方を更新する
+  スレーブアドレスの変更(DRIVE)、シグニチャ不一致時はキャッシュを無効にし、次回アクセス時に読み直す
 
 ・EEPROMのデータフォーマット(括弧内はバイトサイズ)
-   0x0000 - 0x000F: ヘッダー部(16) :  シグニチャ(4)+ボリューム名(10)+レコード数(1)+ブロックサイズ(1)
-     シグニチャ    : フォーマット確認用4文字ID
-     ボリューム名  : 複数のEEPROMの識別用 10文字の文字列
-     レコード数    : 保存出来るファイル数 0 ～ 255迄 
-     ブロックサイズ: 1ファイル(1ページ) 当たりのサイズ、256倍してサイズ(バイト数)                                
-
-   0x0010 - 0x0010+16xレコード数-1: ファイル管理テーブル(16xレコード数)
-     レコード(16) :ファイル名(14)+ 種別(1) + 予備(1)
+   0x0000 - 0x001F: ヘッダー部(32)
+     シグニチャ(4)+ボリューム名(10)+レコード数(1)+フォーマット識別(1)
+     +ブロックサイズ(1)+ブロック数(1)+ブロック選択ビット位置(1)+ページサイズ(1)+データ領域先頭(4)+予備(8)
+       シグニチャ    : フォーマット確認用4文字ID
+       ボリューム名  : 複数のEEPROMの識別用 10文字の文字列
+       レコード数    : 保存出来るファイル数 0 ～ 255迄
+       フォーマット識別: 0x82 (旧形式のブロックサイズ(1～16)と区別する)
+       ブロックサイズ: 2のべき乗の指数(6:64バイト ～ 12:4096バイト)
+       ブロック数    : データ領域のブロック数 1 ～ 253迄
+
+   0x0020 - : ファイル管理テーブル(16xレコード数)
+     レコード(16) :ファイル名(14)+ 種別(1) + 先頭ブロック番号(1)
         ファイル名 ：0～14文字のファイル名(重複名は禁止,先頭1バイトが0の場合はブランクと判定)
         種別      ：ファイルタイプ(0:ブランク, 1:プログラム(デフォルト), 2:データ)
-        予備      ：未使用
-    
-     レコードは0～レコード数-1のレコード番号で管理する。
-     レコード番号は、ファイルデータ本体の位置特定にも利用する
-
- 0x0010+16xレコード数 - : ファイルデータ本体(ブロックサイズx256)xレコード数
-     レコード番号は、ファイルデータ本体の位置特定にも利用する     
-
-対応EEPROM容量の想定
- レコードサイズ512の場合
-   4k: 4096バイト  (ヘッダ(16),ファイル管理(16)x7,  ファイル数 7)
-   8k: 8192バイト  (ヘッダ(16),ファイル管理(16)x15, ファイル数 15)
-  16k:16384バイト  (ヘッダ(16),ファイル管理(16)x31, ファイル数 31)
-  32k:32768バイト  (ヘッダ(16),ファイル管理(16)x62, ファイル数 62)
-  64k:65536バイト  (ヘッダ(16),ファイル管理(16)x124, ファイル数124)
-
- レコードサイズ1024の場合
-   4k: 4096バイト  (ヘッダ(16),ファイル管理(16)x3,  ファイル数 3)
-   8k: 8192バイト  (ヘッダ(16),ファイル管理(16)x7,  ファイル数 7)
-  16k:16384バイト  (ヘッダ(16),ファイル管理(16)x15, ファイル数 15)
-  32k:32768バイト  (ヘッダ(16),ファイル管理(16)x31, ファイル数 31)
-  64k:65536バイト  (ヘッダ(16),ファイル管理(16)x63, ファイル数 63)
-
- レコードサイズ2048の場合
-   4k: 4096バイト  (ヘッダ(16),ファイル管理(16)x1,  ファイル数 1)
-   8k: 8192バイト  (ヘッダ(16),ファイル管理(16)x3,  ファイル数 3)
-  16k:16384バイト  (ヘッダ(16),ファイル管理(16)x7,  ファイル数 7)
-  32k:32768バイト  (ヘッダ(16),ファイル管理(16)x15, ファイル数 15)
-  64k:65536バイト  (ヘッダ(16),ファイル管理(16)x31, ファイル数 31)
-  
- レコードサイズ4096の場合
-   4k: 4096バイト  利用不可
-   8k: 8192バイト  (ヘッダ(16),ファイル管理(16)x1,  ファイル数 1)
-  16k:16384バイト  (ヘッダ(16),ファイル管理(16)x3,  ファイル数 3)
-  32k:32768バイト  (ヘッダ(16),ファイル管理(16)x7,  ファイル数 7)
-  64k:65536バイト  (ヘッダ(16),ファイル管理(16)x15, ファイル数 15)
- 
+
+   ファイル管理テーブル以降 : ブロック割当て表(ブロック数)
+     ブロック番号1から順に、次のブロック番号を格納する(0x00:空き 0xFF:最終ブロック 0xFE:予約)
+
+   データ領域先頭 - : ファイルデータ本体(ブロックサイズxブロック数)
+     ブロック番号nの位置は、データ領域先頭+(n-1)xブロックサイズ
+     ファイルの先頭ブロックの先頭4バイトにファイル長を格納し、その後ろにデータを格納する
+
+対応EEPROM容量の想定(フォーマット時のレコード数はTiny BASICのFORMATコマンドの設定)
+    4k:  4096バイト (レコード数 16, ブロックサイズ   64, ブロック数  58)
+    8k:  8192バイト (レコード数 32, ブロックサイズ   64, ブロック数 117)
+   16k: 16384バイト (レコード数 64, ブロックサイズ   64, ブロック数 235)
+   32k: 32768バイト (レコード数128, ブロックサイズ  128, ブロック数 237)
+   64k: 65536バイト (レコード数128, ブロックサイズ  256, ブロック数 246)
+  128k:131072バイト (レコード数128, ブロックサイズ  512, ブロック数 251)
+  256k:262144バイト (レコード数128, ブロックサイズ 1024, ブロック数 253)
 */
 
 #include <Arduino.h>
 
-#define TI2CEEPROM_FSIZE    512  // デフォルトの１ファイルのサイズ(バイト)
 #define TI2CEEPROM_FNAMESIZ 14   // ファイル名長さ
+#define TI2CEEPROM_PGSIZE   32   // デフォルトのEEPROMページサイズ(バイト)
+#define TI2CEEPROM_NBLKMAX  253  // 最大ブロック数
+
+// ファイル管理テーブルのキャッシュ件数(SRAM容量に応じて設定、1件16バイト)
+// キャッシュ件数が0の場合は、ブロック割当て表もキャッシュしない
+#ifndef TI2CEEPROM_CACHENUM
+  #if RAMEND > 0x2200
+    #define TI2CEEPROM_CACHENUM 32  // 1284 (16kバイト)
+  #elif RAMEND > 0x900
+    #define TI2CEEPROM_CACHENUM 16  // MEGA2560 (8kバイト)
+  #else
+    #define TI2CEEPROM_CACHENUM 0   // Uno (2kバイト) ヘッダーのみキャッシュ
+  #endif
+#endif
 
 #define TI2CEEPROM_F_NONE    0   // ファイル種別:ブランク
 #define TI2CEEPROM_F_PRG     1   // ファイル種別:プログラム
 #define TI2CEEPROM_F_DATA    2   // ファイル種別:データ
 
+// データファイル
+#define TI2CEEPROM_WBUFSIZE  30    // 書込みバッファサイズ(Wireの送信バッファ32-アドレス2)
+#define TI2CEEPROM_FCLOSED   0xFF  // 未オープン
+
+typedef struct {
+  uint8_t  index;                    // ファイル管理テーブル番号(TI2CEEPROM_FCLOSED:未オープン)
+  uint8_t  mode;                     // 0:読込みのみ 1:追記
+  uint8_t  top;                      // 先頭ブロック番号
+  uint8_t  blk;                      // 末尾ブロック番号
+  uint32_t len;                      // 書込み済みファイル長
+  uint8_t  n;                        // 書込みバッファ内データ数
+  uint8_t  buf[TI2CEEPROM_WBUFSIZE]; // 書込みバッファ
+} ti2ceeprom_file_t;
+
 class TI2CEEPROM {
  private:
    uint8_t _devaddr;  // I2Cスレーブアドレス
+   uint8_t _pgsize;   // EEPROMのページサイズ
+   uint8_t _asel;     // ブロック選択ビット位置
+   uint8_t _flgCache; // キャッシュ有効フラグ
+   uint8_t _ioerr;    // ブロック割当て表アクセス時のI2Cデバイスエラー
+   uint8_t _head[32]; // ヘッダーキャッシュ
+#if TI2CEEPROM_CACHENUM > 0
+   uint8_t _tbl[TI2CEEPROM_CACHENUM][16]; // ファイル管理テーブルキャッシュ
+   uint8_t _fat[TI2CEEPROM_NBLKMAX];      // ブロック割当て表キャッシュ
+   uint8_t _fatlo, _fathi;                // ブロック割当て表の未書込み範囲
+#endif
+
+   uint8_t loadCache();                                                   // キャッシュへの読込み
+   uint8_t readEntry(uint8_t index, uint8_t* buf, uint8_t len);           // ファイル管理テーブルの読込み
+   uint8_t writeEntry(uint8_t index, uint8_t* buf);                       // ファイル管理テーブルの書込み
+   uint8_t devAddr(uint32_t addr);                                        // アクセス先I2Cスレーブアドレスの取得
+   uint32_t fatAddr();                                                    // ブロック割当て表の先頭アドレス
+   uint32_t blkAddr(uint8_t blk);                                         // ブロックの先頭アドレス
+   uint8_t getFat(uint8_t blk);                                           // ブロック割当て表の参照
+   void setFat(uint8_t blk, uint8_t next);                                // ブロック割当て表の設定
+   uint8_t flushFat();                                                    // ブロック割当て表の書込み
+   uint8_t countFree();                                                   // 空きブロック数の取得
+   uint8_t alloc(uint8_t num);                                            // ブロックの割当て
+   void freeChain(uint8_t blk);                                           // ブロックの解放
+   uint8_t access(uint8_t blk, uint32_t pos, uint8_t* ptr, uint16_t len, uint8_t flgWrite); // ファイル内データの読み書き
+   uint8_t cmpBlk(uint8_t blk, uint32_t pos, const uint8_t* head, uint8_t hlen,
+                  const uint8_t* ptr, uint16_t len);                      // 保存データとブロックの内容の比較
+   uint8_t swapBlk(uint8_t x, uint8_t d);                                 // ブロックの入れ替え
+   uint8_t writeBuf(ti2ceeprom_file_t* f);                                // 書込みバッファの書込み
 
  public:
-   TI2CEEPROM(uint8_t addr);                                              // コンストラクタ
-   void setSlaveAddr(uint8_t addr) { _devaddr = addr;};                   // I2Cスレーブアドレスの設定
+   TI2CEEPROM(uint8_t addr, uint8_t pgsize=TI2CEEPROM_PGSIZE);            // コンストラクタ
+   void setSlaveAddr(uint8_t addr) { _devaddr = addr; _flgCache = 0;};    // I2Cスレーブアドレスの設定
+   void invalidate() { _flgCache = 0;};                                   // キャッシュの無効化
+   void setPageSize(uint8_t pgsize) { _pgsize = pgsize;};                 // EEPROMのページサイズの設定
    uint8_t checkSign(uint8_t* sign);                                      // シグニチャのチェック
-   int16_t pageSize();                                                    // ページサイズ(最大ファイル保存サイズ)の取得
+   int16_t blockSize();                                                   // ブロックサイズの取得
    int16_t maxFiles();                                                    // 最大ファイル数の取得
    int16_t countFiles() ;                                                 // 保存ファイル数の取得
+   int32_t freeSize();                                                    // 空き容量の取得
    uint8_t getDevName(uint8_t* devname);                                  // デバイス名の取得
-   uint8_t format(uint8_t* sign, uint8_t* devname,uint8_t numtable, uint16_t fsize=TI2CEEPROM_FSIZE); // EEPROMのフォーマット
-   uint8_t load(uint8_t* fname, uint8_t* pos, uint8_t*ptr, uint16_t len); // データのロード
-   uint8_t save(uint8_t* fname, uint8_t* pos, uint8_t*ptr, uint16_t len, uint8_t ftyple=TI2CEEPROM_F_DATA); // データの保存
+   uint8_t format(uint8_t* sign, uint8_t* devname,uint8_t numtable, uint16_t devsize, uint8_t asel=0); // EEPROMのフォーマット
+   int32_t fileSize(uint8_t* fname);                                      // ファイルサイズの取得
+   uint8_t load(uint8_t* fname, uint16_t pos, uint8_t*ptr, uint16_t len); // データのロード
+   uint8_t save(uint8_t* fname, uint8_t*ptr, uint16_t len, uint8_t ftyple=TI2CEEPROM_F_DATA,
+                const uint8_t* head=NULL, uint8_t hlen=0);              // データの保存
    uint8_t del(uint8_t* fname);                                           // ファイルの削除
+   uint8_t compact();                                                     // 詰め直し
    int16_t find(uint8_t* fname);                                          // ファイルを検索し、インデックスを返す
    int16_t findEmpty();                                                   // 空きテーブルのインデックスを返す
    uint8_t getTable(uint8_t* table, uint8_t index);                       // 指定管理テーブルの取得
-
-   uint8_t read(uint16_t addr, uint8_t* buf,uint16_t len);                // 指定アドレスのデータ読込
-   uint8_t write(uint16_t addr, uint8_t* buf, uint16_t len);              // 指定アドレスへのデータ書込み
-   uint8_t read16(uint16_t addr, uint8_t* buf,uint16_t len);
-   uint8_t write16(uint16_t addr, uint8_t* buf, uint16_t len);
+   uint8_t open(ti2ceeprom_file_t* f, uint8_t* fname, uint8_t flgAppend,
+                uint8_t ftype=TI2CEEPROM_F_DATA);                       // データファイルのオープン
+   uint8_t append(ti2ceeprom_file_t* f, uint8_t* ptr, uint16_t len);      // データファイルへの追記
+   uint8_t readData(ti2ceeprom_file_t* f, uint32_t pos, uint8_t* ptr, uint16_t len); // データファイルの読込み
+   uint8_t flush(ti2ceeprom_file_t* f) { return writeBuf(f); };           // 書込みバッファの書込み
+   uint8_t close(ti2ceeprom_file_t* f);                                   // データファイルのクローズ
+
+   uint8_t read(uint32_t addr, uint8_t* buf,uint16_t len);                // 指定アドレスのデータ読込
+   uint8_t write(uint32_t addr, uint8_t* buf, uint16_t len);              // 指定アドレスへのデータ書込み
+   uint8_t update(uint32_t addr, uint8_t* buf, uint16_t len);             // 指定アドレスへのデータ書込み(比較書込み)
+   uint8_t readBlk(uint32_t addr, uint8_t* buf, uint8_t len);             // 一括読込み
+   uint8_t writeBlk(uint32_t addr, uint8_t* buf, uint8_t len);            // 一括書込み
+   uint8_t waitReady(uint8_t dev);                                        // 書込み完了待ち
 };
 
 #endif
@@ -0,0 +1,148 @@
+//
+// TLZSS 簡易LZSS圧縮・伸長クラス(プログラム保存用)
+// 作成 2026/10/19
+//
+
+#include "TLZSS.h"
+
+////////////////////////////////////////////////////
+// 圧縮
+// 引数
+//  src  : 圧縮元データ
+//  len  : 圧縮元データ長
+//  dst  : 圧縮データ格納アドレス(srcと重ならないこと)
+//  size : 圧縮データ格納領域サイズ
+// 戻り値
+//  圧縮データ長(ヘッダー含む)、0:格納領域に収まらない
+////////////////////////////////////////////////////
+uint16_t TLZSS::encode(const uint8_t* src, uint16_t len, uint8_t* dst, uint16_t size) {
+  uint16_t i = 0, o, fpos = 0, from, max, best, boff = 0, n, w;
+  uint8_t  bit = 0;
+
+  if (size < TLZSS_HEADSIZE)
+    return 0;
+  dst[0] = TLZSS_SIGN;
+  dst[1] = len & 0xff;
+  dst[2] = len >> 8;
+  o = TLZSS_HEADSIZE;
+
+  while (i < len) {
+    // 8要素毎にフラグを確保
+    if (!bit) {
+      if (o >= size)
+        return 0;
+      fpos = o++;
+      dst[fpos] = 0;
+      bit = 1;
+    }
+
+    // 参照範囲内の最長一致を検索(近い位置から)
+    best = 0;
+    from = (i > TLZSS_WINDOW) ? i - TLZSS_WINDOW : 0;
+    max  = (len - i > TLZSS_MAXLEN) ? TLZSS_MAXLEN : len - i;
+    for (uint16_t j = i; j-- > from; ) {
+      if (src[j] != src[i])
+        continue;
+      for (n = 1; n < max && src[j+n] == src[i+n]; n++);
+      if (n > best) {
+        best = n;
+        boff = i - j;
+        if (n == max)
+          break;
+      }
+    }
+
+    if (best >= TLZSS_MINLEN) {
+      // 参照
+      if (o + 2 > size)
+        return 0;
+      w = ((best - TLZSS_MINLEN) << TLZSS_OFFBITS) | (boff - 1);
+      dst[o++] = w & 0xff;
+      dst[o++] = w >> 8;
+      i += best;
+    } else {
+      // 生データ
+      if (o >= size)
+        return 0;
+      dst[fpos] |= bit;
+      dst[o++] = src[i++];
+    }
+    bit <<= 1;
+  }
+  return o;
+}
+
+////////////////////////////////////////////////////
+// 元データ長の取得
+// 引数
+//  head : 圧縮データ先頭(ヘッダー部)
+// 戻り値
+//  元データ長、0:圧縮データではない
+////////////////////////////////////////////////////
+uint16_t TLZSS::size(const uint8_t* head) {
+  if (head[0] != TLZSS_SIGN)
+    return 0;
+  return head[1] | (head[2] << 8);
+}
+
+////////////////////////////////////////////////////
+// 圧縮データ1バイトの取得
+// 戻り値
+//  データ、-1:読込みエラー
+////////////////////////////////////////////////////
+int16_t TLZSS::getByte() {
+  if (_bi >= TLZSS_RDSIZE) {
+    if (_reader(_pos, _buf, TLZSS_RDSIZE))
+      return -1;
+    _pos += TLZSS_RDSIZE;
+    _bi = 0;
+  }
+  return _buf[_bi++];
+}
+
+////////////////////////////////////////////////////
+// 伸長
+// 引数
+//  reader : 圧縮データ読込み関数
+//  dst    : 伸長データ格納アドレス
+//  len    : 伸長データ長(元データ長より短い場合は先頭部分のみ伸長する)
+// 戻り値
+//  0:正常、1:読込みエラーまたは圧縮データ破損
+////////////////////////////////////////////////////
+uint8_t TLZSS::decode(tlzss_reader_t reader, uint8_t* dst, uint16_t len) {
+  uint16_t o = 0, w, off, n;
+  int16_t  c, d;
+  uint8_t  flg = 0, bit = 0;
+
+  _reader = reader;
+  _pos = TLZSS_HEADSIZE;
+  _bi = TLZSS_RDSIZE;
+
+  while (o < len) {
+    if (!bit) {
+      if ( (c = getByte()) < 0 )
+        return 1;
+      flg = c;
+      bit = 1;
+    }
+    if (flg & bit) {
+      // 生データ
+      if ( (c = getByte()) < 0 )
+        return 1;
+      dst[o++] = c;
+    } else {
+      // 参照
+      if ( (c = getByte()) < 0 || (d = getByte()) < 0 )
+        return 1;
+      w   = c | (d << 8);
+      off = (w & (TLZSS_WINDOW-1)) + 1;
+      n   = (w >> TLZSS_OFFBITS) + TLZSS_MINLEN;
+      if (off > o)
+        return 1;  // 参照位置が不正
+      for (; n && o < len; n--, o++)
+        dst[o] = dst[o - off];
+    }
+    bit <<= 1;
+  }
+  return 0;
+}
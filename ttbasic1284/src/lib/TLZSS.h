@@ -0,0 +1,57 @@
+//
+// TLZSS 簡易LZSS圧縮・伸長クラス(プログラム保存用)
+// 作成 2026/10/19
+//
+
+#ifndef __TLZSS_H__
+#define __TLZSS_H__
+
+/*
+このライブラリは、中間コード化したBASICプログラムをEEPROMに保存する際の
+圧縮・伸長を行うためのものです。
+
+[仕様]
+・LZSS方式(直前の出現箇所への参照と生データの組合せ)で圧縮する
+  中間コード、行番号、コメント等の繰り返しを参照に置き換える
+・圧縮はメモリ上のデータからメモリ上に行い、圧縮後のサイズが元より小さくならない場合は行わない
+・伸長は読込み関数で少しずつ読み込みながら行い、圧縮データ全体を展開するための領域を必要としない
+  (EEPROMから直接プログラム領域に展開する)
+
+・圧縮データのフォーマット(括弧内はバイトサイズ)
+   ヘッダー部(3) : 識別子 0xFF(1)+元データ長(2)
+     ※プログラム先頭の行長は0xFFにならないため、非圧縮データと区別できる
+   データ部 : (フラグ(1)+要素 x 8) の繰り返し
+     フラグ : 下位ビットから順に後続の要素の種類(1:生データ 0:参照)
+     生データ(1) : データ1バイト
+     参照(2)     : 下位10ビット 参照位置(1～1024バイト前)-1、上位6ビット 一致長(3～66)-3
+*/
+
+#include <Arduino.h>
+
+#define TLZSS_SIGN      0xFF  // 圧縮データ識別子
+#define TLZSS_HEADSIZE  3     // ヘッダーサイズ
+#define TLZSS_OFFBITS   10    // 参照位置のビット数
+#define TLZSS_WINDOW    (1<<TLZSS_OFFBITS)                          // 参照範囲
+#define TLZSS_MINLEN    3                                           // 最小一致長
+#define TLZSS_MAXLEN    (TLZSS_MINLEN + (1<<(16-TLZSS_OFFBITS)) - 1) // 最大一致長
+#define TLZSS_RDSIZE    32    // 伸長時の読込み単位
+
+// 圧縮データ読込み関数(pos:圧縮データ内位置 戻り値 0:正常 0以外:エラー)
+typedef uint8_t (*tlzss_reader_t)(uint16_t pos, uint8_t* buf, uint8_t len);
+
+class TLZSS {
+ private:
+   tlzss_reader_t _reader;                // 圧縮データ読込み関数
+   uint8_t  _buf[TLZSS_RDSIZE];           // 読込みバッファ
+   uint8_t  _bi;                          // 読込みバッファ内位置
+   uint16_t _pos;                         // 次回読込み位置
+
+   int16_t getByte();                     // 圧縮データ1バイトの取得
+
+ public:
+   static uint16_t encode(const uint8_t* src, uint16_t len, uint8_t* dst, uint16_t size); // 圧縮
+   static uint16_t size(const uint8_t* head);                                             // 元データ長の取得
+   uint8_t decode(tlzss_reader_t reader, uint8_t* dst, uint16_t len);                     // 伸長
+};
+
+#endif
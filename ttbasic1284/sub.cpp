@@ -4,6 +4,7 @@
 // 修正 2019/06/11 GETFONTコマンドの追加（美咲フォント対応）
 // 修正 2019/07/01 ihex()とibin()を統合し、メモリ制約
 // 修正 2019/09/07 imap()の計算をmap()を使うように修正
+// 修正 2026/10/19 POKEでのプログラム領域書込み時、内部EEPROMへの保存完了を待つように修正
 //
 
 #include "Arduino.h"
@@ -368,6 +369,8 @@ void ipoke() {
     }
     cip++;          // 中間コードポインタを次へ進める
     if (getParam(value,false)) return; 
+    if (adr >= listbuf && adr < listbuf + SIZE_LIST)
+      waitSave();   // プログラム領域への書込みは保存完了を待つ
     *((uint8_t*)adr) = (uint8_t)value;
     vadr++;
   } while(*cip == I_COMMA);
@@ -6,6 +6,17 @@
 // 修正 2019/08/04 外部割込みイベント利用オプション設定の追加
 // 修正 2019/09/07 機能利用オプション設定のデフォルト設定の見直し
 // 修正 2019/10/08 MEGA2560用の機能利用オプション設定を追加
+// 修正 2026/10/19 高速起動オプション設定の追加
+// 修正 2026/10/19 内部EEPROMのウェアレベリングオプション設定の追加
+// 修正 2026/10/19 プログラム保存時の圧縮オプション設定の追加
+// 修正 2026/10/19 I2C EEPROMのデータファイルオプション設定の追加
+// 修正 2026/10/19 I2C EEPROMのプログラムのページ実行オプション設定の追加
+// 修正 2026/10/19 プログラム領域のバンク数の設定の追加
+// 修正 2026/10/19 ROMプログラム(フラッシュメモリ上のプログラム)オプション設定の追加
+// 修正 2026/10/19 実行状態の保存・復元(SNAPSHOT、RESUME)オプション設定の追加
+// 修正 2026/10/19 プログラムの一括入力(UPLOAD)オプション設定、RTS出力ピンの追加
+// 修正 2026/10/19 ERASE WIPE、ASAVE・ALOAD、CHAIN、PACKのオプション設定の追加
+// 修正 2026/10/19 ATmega1284のプログラム領域のバンク数のデフォルトを1に変更
 //
 
 #ifndef __ttconfig_h__
@@ -34,14 +45,17 @@
   // Arduino MEGA2560
   #define   TonePin 49  // Tone用出力ピン（圧電スピーカー接続）
   #define   AutoPin 53  // 自動起動チェックピン
+  #define   RtsPin  -1  // UPLOADのフロー制御用RTS出力ピン(-1:XON/XOFFを利用 デフォルト:-1)
 #elif defined(ARDUINO_AVR_ATmega1284)
   // Arduino MEGA1284
   #define   TonePin 1  // Tone用出力ピン（圧電スピーカー接続）
   #define   AutoPin 2  // 自動起動チェックピン
+  #define   RtsPin  -1 // UPLOADのフロー制御用RTS出力ピン(-1:XON/XOFFを利用 デフォルト:-1)
 #else
   // Arduino Uno/nano/pro mini
   #define   TonePin 8  // Tone用出力ピン（圧電スピーカー接続）
   #define   AutoPin 7  // 自動起動チェックピン
+  #define   RtsPin  -1  // UPLOADのフロー制御用RTS出力ピン(-1:XON/XOFFを利用 デフォルト:-1)
 #endif
 
 // ** プログラム領域サイズ ***************************************************
@@ -49,14 +63,17 @@
   // Arduino MEGA2560
   #define   PRGAREASIZE 2048 // プログラム領域サイズ(Arduino Mega 512 ～ 4096 デフォルト:2048)
   #define   ARRYSIZE    100  // 配列領域
+  #define   PRGBANKNUM  1    // プログラム領域のバンク数(1 ～ デフォルト:1)
 #elif defined(ARDUINO_AVR_ATmega1284)
   // Arduino MEGA1284
   #define   PRGAREASIZE 2048 // プログラム領域サイズ(Arduino Mega 512 ～ 4096 デフォルト:2048)
   #define   ARRYSIZE    300  // 配列領域
+  #define   PRGBANKNUM  1    // プログラム領域のバンク数(1 ～ デフォルト:1) ※2以上でPRGAREASIZE x バンク数のSRAMを使用(4程度まで)
 #else
   // Arduino Uno/nano/pro mini
   #define   PRGAREASIZE 1024 // プログラム領域サイズ(Arduino Uno  512 ～ 1024 デフォルト:1024)
   #define   ARRYSIZE    32   // 配列領域
+  #define   PRGBANKNUM  1    // プログラム領域のバンク数(1 ～ デフォルト:1)
 #endif
 
 #define USE_ALL_KEYWORD  1   // 未使用キーワードも有効にする(1:有効 2:無効 デフォルト:1)
@@ -81,6 +98,19 @@
 #define USE_NEOPIXEL   1  // NeoPixelの利用(0:利用しない 1:利用する デフォルト:1)
 #define USE_EVENT      1  // タイマー・外部割込みイベントの利用(0:利用しない 1:利用する デフォルト:1)
 #define USE_SLEEP      1  // SLEEPコマンドの利用(0:利用しない 1:利用する デフォルト:1) ※USE_EVENTを利用必須
+#define USE_FASTBOOT   1  // 自動起動時の高速起動(0:利用しない 1:利用する デフォルト:1)
+#define USE_EEPROM_WL  1  // 内部EEPROM保存のウェアレベリング(0:利用しない 1:利用する デフォルト:1)
+#define USE_PRGCOMP    1  // プログラム保存時の圧縮(0:利用しない 1:利用する デフォルト:1)
+#define USE_ERASEWIPE  1  // ERASEの消去オプション(WIPE)(0:利用しない 1:利用する デフォルト:1)
+#define USE_ADATA      1  // 配列・変数の保存・読込み(ASAVE,ALOAD,RUN VAR)(0:利用しない 1:利用する デフォルト:1)
+#define USE_CHAIN      1  // プログラムの連結実行(CHAIN)(0:利用しない 1:利用する デフォルト:1)
+#define USE_DATAFILE   1  // I2C EEPROMのデータファイル(OPEN,WRITE#,READ#等)(0:利用しない 1:利用する デフォルト:1)
+#define USE_PAGEDRUN   1  // I2C EEPROMのプログラムのページ実行(RUN "ファイル名")(0:利用しない 1:利用する デフォルト:1) ※USE_I2CEEPROMを利用必須
+#define USE_ROMPRG     1  // ROMプログラム(RUN ROM,LOAD ROM,SAVE ROM,FILES ROM)(0:利用しない 1:利用する デフォルト:1) ※USE_PAGEDRUNを利用必須
+#define USE_SNAPSHOT   1  // 実行状態の保存・復元(SNAPSHOT,RESUME)(0:利用しない 1:利用する 2:自動起動時に再開 デフォルト:1)
+                          // ※2の場合、内部EEPROMの最後の保存番号のスナップショットから自動起動する
+#define USE_PACK       1  // プログラムの不要部分の削除(PACK)(0:利用しない 1:利用する デフォルト:1)
+#define USE_UPLOAD     1  // プログラムの一括入力(UPLOAD)(0:利用しない 1:利用する デフォルト:1)
 #else
 // ** 機能利用オプション設定 for Arduino Uno *********************************
 #define USE_CMD_PLAY   0  // PLAYコマンドの利用(0:利用しない 1:利用する デフォルト:0)
@@ -101,6 +131,19 @@
 #define USE_NEOPIXEL   0  // NeoPixelの利用(0:利用しない 1:利用する デフォルト:0)
 #define USE_EVENT      1  // タイマー・外部割込みイベントの利用(0:利用しない 1:利用する デフォルト:1)
 #define USE_SLEEP      1  // SLEEPコマンドの利用(0:利用しない 1:利用する デフォルト:1) ※USE_EVENTを利用必須
+#define USE_FASTBOOT   0  // 自動起動時の高速起動(0:利用しない 1:利用する デフォルト:0)
+#define USE_EEPROM_WL  0  // 内部EEPROM保存のウェアレベリング(0:利用しない 1:利用する デフォルト:0)
+#define USE_PRGCOMP    0  // プログラム保存時の圧縮(0:利用しない 1:利用する デフォルト:0)
+#define USE_ERASEWIPE  1  // ERASEの消去オプション(WIPE)(0:利用しない 1:利用する デフォルト:1)
+#define USE_ADATA      1  // 配列・変数の保存・読込み(ASAVE,ALOAD,RUN VAR)(0:利用しない 1:利用する デフォルト:1)
+#define USE_CHAIN      1  // プログラムの連結実行(CHAIN)(0:利用しない 1:利用する デフォルト:1)
+#define USE_DATAFILE   0  // I2C EEPROMのデータファイル(OPEN,WRITE#,READ#等)(0:利用しない 1:利用する デフォルト:0)
+#define USE_PAGEDRUN   0  // I2C EEPROMのプログラムのページ実行(RUN "ファイル名")(0:利用しない 1:利用する デフォルト:0) ※USE_I2CEEPROMを利用必須
+#define USE_ROMPRG     0  // ROMプログラム(RUN ROM,LOAD ROM,SAVE ROM,FILES ROM)(0:利用しない 1:利用する デフォルト:0) ※USE_PAGEDRUNを利用必須
+#define USE_SNAPSHOT   0  // 実行状態の保存・復元(SNAPSHOT,RESUME)(0:利用しない 1:利用する 2:自動起動時に再開 デフォルト:0)
+                          // ※2の場合、内部EEPROMの最後の保存番号のスナップショットから自動起動する
+#define USE_PACK       0  // プログラムの不要部分の削除(PACK)(0:利用しない 1:利用する デフォルト:0)
+#define USE_UPLOAD     0  // プログラムの一括入力(UPLOAD)(0:利用しない 1:利用する デフォルト:0)
 #endif
 
 #endif